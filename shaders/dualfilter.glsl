@@ -183,10 +183,27 @@ void main() {
 }
 @end
 
+// Copies a band of rows from a staging image into a glyph atlas page. The viewport covers the band, and
+// gl_FragCoord.y is the row in memory on every backend
+@fs atlas_copy_fs
+layout(binding=0)uniform texture2D tex;
+layout(binding=0)uniform sampler smp;
+layout(binding=0) uniform fs_atlas_copy {
+    float u_y0;
+};
+
+out vec4 frag_color;
+
+void main() {
+    frag_color = texelFetch(sampler2D(tex, smp), ivec2(gl_FragCoord.x, gl_FragCoord.y - u_y0), 0);
+}
+@end
+
 @program lightfilter fullscreen_triangle_vs lightfilter_fs
 @program texread fullscreen_triangle_vs texread_fs
 @program kawase_blur fullscreen_triangle_vs kawase_blur_fs
 @program downsample fullscreen_triangle_vs downsample_fs
 @program upsample fullscreen_triangle_vs upsample_fs
 @program upsample_mix fullscreen_triangle_vs upsample_mix_fs
-@program bloom fullscreen_triangle_vs bloom_fs
\ No newline at end of file
+@program bloom fullscreen_triangle_vs bloom_fs
+@program atlas_copy fullscreen_triangle_vs atlas_copy_fs
\ No newline at end of file
@@ -7,15 +7,21 @@ layout (binding = 0) uniform viewSize {
     mat4 dummy;
 #endif
     vec4 _viewSize;
+    // x: added to the vertex's uniforms index. Draws using a call's second set of uniforms pass 1
+    vec4 _fragOffset;
 };
 layout (location = 0) in vec2 vertex;
 layout (location = 1) in vec2 tcoord;
+// Index of the vertex's call in the uniforms storage buffer
+layout (location = 2) in float frag;
 layout (location = 0) out vec2 ftcoord;
 layout (location = 1) out vec2 fpos;
+layout (location = 2) flat out int frag_idx;
 
 void main(void) {
 	ftcoord = tcoord;
 	fpos = vertex;
+	frag_idx = int(frag + _fragOffset.x + 0.5);
     float x = 2.0 * (vertex.x - _viewSize.x) / _viewSize.z - 1.0;
     float y = 1.0 - 2.0 * (vertex.y - _viewSize.y) / _viewSize.w;
 	gl_Position = vec4(
@@ -27,7 +33,8 @@ void main(void) {
 }
 @end
 
-@fs fs
+// Uniforms & paint shading shared by fs and fs_shape. Include after declaring frag_idx
+@block frag_common
 precision highp float;
 #if defined(_HLSL5_) && !defined(USE_SOKOL)
     uniform frag {
@@ -71,30 +78,33 @@ precision highp float;
             int type;
         };
     #else
-        layout(std140,binding=1) uniform frag {
+        // Uniforms of every call this frame, so calls sharing a pipeline & texture can be drawn together.
+        // See SGNVGfragUniforms
+        struct frag_uniforms {
             vec4 dummy[11];
         };
-        #define scissorMat mat3(dummy[0].xyz, dummy[1].xyz, dummy[2].xyz)
-        #define paintMat mat3(dummy[3].xyz, dummy[4].xyz, dummy[5].xyz)
-        #define innerCol dummy[6]
-        #define outerCol dummy[7]
-        #define scissorExt dummy[8].xy
-        #define scissorScale dummy[8].zw
-        #define extent dummy[9].xy
-        #define radius dummy[9].z
-        #define feather dummy[9].w
-        #define strokeMult dummy[10].x
-        #define strokeThr dummy[10].y
-        #define texType int(dummy[10].z)
-        #define type int(dummy[10].w)
+        layout(binding=0) readonly buffer sb_frag {
+            frag_uniforms frags[];
+        };
+        #define scissorMat mat3(frags[frag_idx].dummy[0].xyz, frags[frag_idx].dummy[1].xyz, frags[frag_idx].dummy[2].xyz)
+        #define paintMat mat3(frags[frag_idx].dummy[3].xyz, frags[frag_idx].dummy[4].xyz, frags[frag_idx].dummy[5].xyz)
+        #define innerCol frags[frag_idx].dummy[6]
+        #define outerCol frags[frag_idx].dummy[7]
+        #define scissorExt frags[frag_idx].dummy[8].xy
+        #define scissorScale frags[frag_idx].dummy[8].zw
+        #define extent frags[frag_idx].dummy[9].xy
+        #define radius frags[frag_idx].dummy[9].z
+        #define feather frags[frag_idx].dummy[9].w
+        #define strokeMult frags[frag_idx].dummy[10].x
+        #define strokeThr frags[frag_idx].dummy[10].y
+        #define texType int(frags[frag_idx].dummy[10].z)
+        #define type int(frags[frag_idx].dummy[10].w)
     #endif
 #endif
 
+
 layout(binding=2) uniform texture2D tex;
 layout(binding=3) uniform sampler smp;
-layout(location = 0) in vec2 ftcoord;
-layout(location = 1) in vec2 fpos;
-layout(location = 0) out vec4 outColor;
 
 #define M_1_PI   0.318309886183790671538  // 1/pi
 #define M_PI     3.14159265359  // 1/pi
@@ -113,10 +123,6 @@ float scissorMask(vec2 p) {
     return clamp(sc.x,0.0,1.0) * clamp(sc.y,0.0,1.0);
 }
 
-// Stroke - from [0..1] to clipped pyramid, where the slope is 1px.
-float strokeMask() {
-    return min(1.0, (1.0-abs(ftcoord.x*2.0-1.0))*strokeMult) * min(1.0, ftcoord.y);
-}
 
 float fastsin(in float x)
 {
@@ -131,6 +137,49 @@ float dither_noise(in vec2 uv_coord){
     return (1.0 / 255.0) * noise - (0.5 / 255.0); // (-0.5 - 0.5) / 255 range. Shift 8bit colour +/- rgb value
 }
 
+// Gradient & image paints, with 'alpha' coverage
+vec4 paintColour(vec2 pos, float alpha, float scissor) {
+    if (type == 1) {// Image
+        // Calculate color fron texture
+        vec2 pt = (paintMat * vec3(pos,1.0)).xy / extent;
+        vec4 color = texture(sampler2D(tex, smp), pt);
+        if (texType == 1) color = vec4(color.xyz*color.w,color.w);
+        if (texType == 2) color = vec4(color.x);
+        // stencil support
+        if (texType == 3 && color.a == 1.0) discard;
+        // Apply color tint and alpha.
+        color *= innerCol;
+        // Combine alpha
+        color *= alpha * scissor;
+        return color;
+    }
+    // Gradient
+    // Calculate gradient color using box gradient
+    vec2 pt = (paintMat * vec3(pos,1.0)).xy;
+    float d = clamp((sdroundrect(pt, extent, radius) + feather*0.5) / feather, 0.0, 1.0);
+    vec4 color = mix(innerCol,outerCol,d);
+    float noise = dither_noise(pos);
+    // Combine alpha
+    color *= alpha;
+    color.rgb += noise;
+    color *= scissor;
+    return color;
+}
+@end
+
+@fs fs
+layout(location = 0) in vec2 ftcoord;
+layout(location = 1) in vec2 fpos;
+layout(location = 2) flat in int frag_idx;
+layout(location = 0) out vec4 outColor;
+
+@include_block frag_common
+
+// Stroke - from [0..1] to clipped pyramid, where the slope is 1px.
+float strokeMask() {
+    return min(1.0, (1.0-abs(ftcoord.x*2.0-1.0))*strokeMult) * min(1.0, ftcoord.y);
+}
+
 void main(void) {
     vec4 result = vec4(0);
 
@@ -142,30 +191,8 @@ void main(void) {
         return;
     }
 
-    if (type == 0) {    // Gradient
-        // Calculate gradient color using box gradient
-        vec2 pt = (paintMat * vec3(fpos,1.0)).xy;
-        float d = clamp((sdroundrect(pt, extent, radius) + feather*0.5) / feather, 0.0, 1.0);
-        vec4 color = mix(innerCol,outerCol,d);
-        float noise = dither_noise(fpos);
-        // Combine alpha
-        color *= strokeAlpha;
-        color.rgb += noise;
-        color *= scissor;
-        result = color;
-    } else if (type == 1) {// Image
-        // Calculate color fron texture
-        vec2 pt = (paintMat * vec3(fpos,1.0)).xy / extent;
-        vec4 color = texture(sampler2D(tex, smp), pt);
-        if (texType == 1) color = vec4(color.xyz*color.w,color.w);
-        if (texType == 2) color = vec4(color.x);
-        // stencil support
-        if (texType == 3 && color.a == 1.0) discard;
-        // Apply color tint and alpha.
-        color *= innerCol;
-        // Combine alpha
-        color *= strokeAlpha * scissor;
-        result = color;
+    if (type == 0 || type == 1) {// Gradient or image
+        result = paintColour(fpos, strokeAlpha, scissor);
     } else if (type == 2) {// Stencil fill
         result = vec4(1,1,1,1);
     } else if (type == 3) {// Textured tris
@@ -178,4 +205,99 @@ void main(void) {
 }
 @end
 
-@program sg vs fs
\ No newline at end of file
+@program sg vs fs
+
+// Rects, rounded rects & circles drawn as one quad each, with coverage from their signed distance. See SGNVGshape
+@vs vs_shape
+struct shape {
+    // x, y, w, h in pixels
+    vec4 rect;
+    // Corner radii: top left, top right, bottom right, bottom left
+    vec4 radii;
+    // x: half stroke width, 0 for fills. y: index into sb_frag. z: fringe width, 0 without antialiasing.
+    // w: 1 if square corners get round stroke joins
+    vec4 params;
+};
+
+layout(binding=1) readonly buffer sb_shapes {
+    shape shapes[];
+};
+
+layout(binding=0) uniform shapeParams {
+    vec4 u_viewSize;
+    int  u_sbo_offset;
+};
+
+layout(location = 0) out vec2 fpos;
+layout(location = 1) flat out vec4 frect;
+layout(location = 2) flat out vec4 fradii;
+layout(location = 3) flat out vec4 fparams;
+layout(location = 4) flat out int frag_idx;
+
+void main(void) {
+    uint s_idx = gl_VertexIndex / 6u;
+    uint i_idx = gl_VertexIndex - s_idx * 6u;
+
+    shape obj = shapes[s_idx + u_sbo_offset];
+
+    // Same corner order as vs_text
+    bool is_right = (gl_VertexIndex & 1) == 1;
+    bool is_bottom = i_idx >= 2 && i_idx <= 4;
+    vec2 corner = vec2(is_right ? 1 : 0, is_bottom ? 1 : 0);
+
+    // Grow the quad to fit the stroke & the antialiased edge
+    float pad = obj.params.x + obj.params.z;
+    vec2 pos = obj.rect.xy - pad + corner * (obj.rect.zw + 2.0 * pad);
+
+    fpos = pos;
+    frect = obj.rect;
+    fradii = obj.radii;
+    fparams = obj.params;
+    frag_idx = int(obj.params.y + 0.5);
+
+    float x = 2.0 * (pos.x - u_viewSize.x) / u_viewSize.z - 1.0;
+    float y = 1.0 - 2.0 * (pos.y - u_viewSize.y) / u_viewSize.w;
+    gl_Position = vec4(x, y, 0, 1);
+}
+@end
+
+@fs fs_shape
+layout(location = 0) in vec2 fpos;
+layout(location = 1) flat in vec4 frect;
+layout(location = 2) flat in vec4 fradii;
+layout(location = 3) flat in vec4 fparams;
+layout(location = 4) flat in int frag_idx;
+layout(location = 0) out vec4 outColor;
+
+@include_block frag_common
+
+// Signed distance to a box with half extents 'b' and a radius per corner. y is down
+float sdroundbox(vec2 p, vec2 b, vec4 r) {
+    float rad = p.x > 0.0 ? (p.y > 0.0 ? r.z : r.y) : (p.y > 0.0 ? r.w : r.x);
+    vec2 q = abs(p) - b + rad;
+    return min(max(q.x,q.y),0.0) + length(max(q,0.0)) - rad;
+}
+
+void main(void) {
+    vec2 ext = frect.zw * 0.5;
+    vec2 p = fpos - (frect.xy + ext);
+    float hs = fparams.x;
+
+    float d = sdroundbox(p, ext, fradii);
+    if (hs > 0.0) {
+        // Ring between the outline grown & shrunk by half the stroke. Square corners stay square unless joins are round
+        vec4 outer = fradii + hs * max(step(0.001, fradii), vec4(fparams.w));
+        vec4 inner = max(fradii - hs, 0.0);
+        d = max(sdroundbox(p, ext + hs, outer), -sdroundbox(p, max(ext - hs, 0.0), inner));
+    }
+
+    float fringe = fparams.z;
+    float coverage = fringe > 0.0 ? clamp(0.5 - d / fringe, 0.0, 1.0) : (d <= 0.0 ? 1.0 : 0.0);
+    if (coverage == 0.0) discard;
+
+    float scissor = scissorMask(fpos);
+    outColor = paintColour(fpos, coverage, scissor);
+}
+@end
+
+@program shape vs_shape fs_shape
@@ -3,14 +3,14 @@
 
 struct text_buffer
 {
-    // NOTE: coord_topleft coords could be compressed to uint16. To support signedness, apply +32767 delta building the SBO, then subtract -32767 here
-    // NOTE: tex atlas coords are 0-255, could be compressed to Unorm4x8
-    // NOTE: coord_bottomright is redundant, could be calculated using topleft + atlas_coords.zw * 255
-
-    vec2 coord_topleft;
-    vec2 coord_bottomright;
-    uint tex_topleft;
-    uint tex_bottomright;
+    // Top left corner in pixels. x & y are int16, stored with a +32768 bias to keep them unsigned
+    uint coord_topleft;
+    // Glyph rect in the atlas in pixels, 8 bits each: x, y, w, h
+    // The glyph quad is its rect in the atlas scaled by u_glyph_scale, so the bottom right corner is
+    // topleft + wh * u_glyph_scale
+    uint atlas_rect;
+    // RGBA8. Glyphs carry their own colour so text in different colours can share a draw
+    uint colour;
 };
 
 layout(binding=0) readonly buffer sb_text {
@@ -21,9 +21,12 @@ layout(binding=0) uniform vs_text_uniforms {
     vec2 u_xy_offset;
     vec2 u_view_size;
     int  u_sbo_offset;
+    // Draw size / raster size. Always 1 except for SDF glyphs
+    float u_glyph_scale;
 };
 
 out vec2 texcoord;
+flat out vec4 colour;
 
 
 void main() {
@@ -42,21 +45,20 @@ void main() {
     // Is odd
     bool is_right = (gl_VertexIndex & 1) == 1;
     bool is_bottom = i_idx >= 2 && i_idx <= 4;
+    vec2 corner = vec2(is_right ? 1 : 0, is_bottom ? 1 : 0);
 
-    vec2 pos = vec2(
-        is_right  ? obj.coord_bottomright.x : obj.coord_topleft.x,
-        is_bottom ? obj.coord_bottomright.y : obj.coord_topleft.y
-    );
+    vec2 topleft = vec2(float(obj.coord_topleft & 0xffffu), float(obj.coord_topleft >> 16)) - 32768.0;
+    uvec4 atlas_rect = (uvec4(obj.atlas_rect) >> uvec4(0, 8, 16, 24)) & 0xffu;
+    vec2 size = vec2(atlas_rect.zw);
+
+    vec2 pos = topleft + corner * size * u_glyph_scale;
     pos = (pos - u_xy_offset) * 2 / u_view_size - vec2(1);
 
 	gl_Position = vec4(pos.x, -pos.y, 0, 1);
 
-    vec2 tex_topleft = unpackUnorm2x16(obj.tex_topleft);
-    vec2 tex_bottomright = unpackUnorm2x16(obj.tex_bottomright);
-    texcoord = vec2(
-        is_right  ? tex_bottomright.x : tex_topleft.x,
-        is_bottom ? tex_bottomright.y : tex_topleft.y
-    );
+    // Atlases are 256x256
+    texcoord = (vec2(atlas_rect.xy) + corner * size) / 256.0;
+    colour = unpackUnorm4x8(obj.colour);
 }
 @end
 
@@ -64,17 +66,13 @@ void main() {
 layout(binding=1) uniform texture2D text_tex;
 layout(binding=0) uniform sampler text_smp;
 
-layout(binding=1) uniform fs_text_singlechannel_uniforms {
-    vec4 u_colour;
-};
-
-
 in vec2 texcoord;
+flat in vec4 colour;
 out vec4 frag_colour;
 
 void main() {
     float alpha = texture(sampler2D(text_tex, text_smp), texcoord).r;
-    frag_colour = vec4(u_colour.rgb, u_colour.a * alpha);
+    frag_colour = vec4(colour.rgb, colour.a * alpha);
 }
 @end
 
@@ -83,20 +81,36 @@ layout(binding=1) uniform texture2D text_tex;
 layout(binding=0) uniform sampler text_smp;
 
 in vec2 texcoord;
+flat in vec4 colour;
 layout(location=0, index=0) out vec4 frag_colour;
 layout(location=0, index=1) out vec4 blend_weights;
 
-layout(binding=1) uniform fs_text_multichannel_uniforms {
-    vec4 u_colour;
-};
-
 void main() {
     vec3 pixel_coverages = texture(sampler2D(text_tex, text_smp), texcoord).rgb;
 
-    frag_colour = u_colour * vec4(pixel_coverages, 1);
-	blend_weights = vec4(u_colour.a * pixel_coverages, u_colour.a);
+    frag_colour = colour * vec4(pixel_coverages, 1);
+	blend_weights = vec4(colour.a * pixel_coverages, colour.a);
+}
+@end
+
+@fs fs_text_sdf
+layout(binding=1) uniform texture2D text_tex;
+layout(binding=0) uniform sampler text_smp;
+
+in vec2 texcoord;
+flat in vec4 colour;
+out vec4 frag_colour;
+
+void main() {
+    // 0.5 is the outline, distances are positive inside the glyph
+    float dist = texture(sampler2D(text_tex, text_smp), texcoord).r - 0.5;
+    // Antialias over one screen pixel, whatever size the glyph is drawn at
+    float width = max(fwidth(dist), 1e-5);
+    float alpha = clamp(dist / width + 0.5, 0.0, 1.0);
+    frag_colour = vec4(colour.rgb, colour.a * alpha);
 }
 @end
 
 @program text_singlechannel vs_text fs_text_singlechannel
-@program text_multichannel vs_text fs_text_multichannel
\ No newline at end of file
+@program text_multichannel vs_text fs_text_multichannel
+@program text_sdf vs_text fs_text_sdf
@@ -249,6 +249,145 @@ void main(void) {
 #include <dualfilter.glsl.h>
 #include <nanovg_sokol.glsl.h>
 
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#define NVG_SIMD_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#define NVG_SIMD_NEON
+#include <arm_neon.h>
+#endif
+
+// Minimal threading, used by the background glyph rasterizer
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+typedef HANDLE             nvg_thread_t;
+typedef SRWLOCK            nvg_mutex_t;
+typedef CONDITION_VARIABLE nvg_cond_t;
+#define NVG_THREAD_PROC(name, arg) static DWORD WINAPI name(LPVOID arg)
+#define NVG_THREAD_RETURN          return 0
+static bool nvg_thread_create(nvg_thread_t* t, LPTHREAD_START_ROUTINE proc, void* arg)
+{
+    *t = CreateThread(NULL, 0, proc, arg, 0, NULL);
+    return *t != NULL;
+}
+static void nvg_thread_join(nvg_thread_t t)
+{
+    WaitForSingleObject(t, INFINITE);
+    CloseHandle(t);
+}
+#define nvg_mutex_init(m)   InitializeSRWLock(m)
+#define nvg_mutex_destroy(m)
+#define nvg_mutex_lock(m)   AcquireSRWLockExclusive(m)
+#define nvg_mutex_unlock(m) ReleaseSRWLockExclusive(m)
+#define nvg_cond_init(c)    InitializeConditionVariable(c)
+#define nvg_cond_destroy(c)
+#define nvg_cond_wait(c, m) SleepConditionVariableSRW(c, m, INFINITE, 0)
+#define nvg_cond_signal(c)  WakeConditionVariable(c)
+#else
+#include <pthread.h>
+typedef pthread_t       nvg_thread_t;
+typedef pthread_mutex_t nvg_mutex_t;
+typedef pthread_cond_t  nvg_cond_t;
+#define NVG_THREAD_PROC(name, arg) static void* name(void* arg)
+#define NVG_THREAD_RETURN          return NULL
+static bool nvg_thread_create(nvg_thread_t* t, void* (*proc)(void*), void* arg)
+{
+    return pthread_create(t, NULL, proc, arg) == 0;
+}
+static void nvg_thread_join(nvg_thread_t t) { pthread_join(t, NULL); }
+#define nvg_mutex_init(m)    pthread_mutex_init(m, NULL)
+#define nvg_mutex_destroy(m) pthread_mutex_destroy(m)
+#define nvg_mutex_lock(m)    pthread_mutex_lock(m)
+#define nvg_mutex_unlock(m)  pthread_mutex_unlock(m)
+#define nvg_cond_init(c)     pthread_cond_init(c, NULL)
+#define nvg_cond_destroy(c)  pthread_cond_destroy(c)
+#define nvg_cond_wait(c, m)  pthread_cond_wait(c, m)
+#define nvg_cond_signal(c)   pthread_cond_signal(c)
+#endif
+
+// Minimal read only file mapping, used by the glyph cache
+typedef struct NVGfileMap
+{
+    const unsigned char* data;
+    size_t               size;
+#ifdef _WIN32
+    HANDLE file;
+    HANDLE mapping;
+#endif
+} NVGfileMap;
+
+#ifdef _WIN32
+static bool nvg_file_map(NVGfileMap* map, const char* path)
+{
+    memset(map, 0, sizeof(*map));
+    map->file =
+        CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (map->file == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER size;
+    if (GetFileSizeEx(map->file, &size) && size.QuadPart > 0)
+    {
+        map->mapping = CreateFileMappingA(map->file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (map->mapping)
+        {
+            map->data = MapViewOfFile(map->mapping, FILE_MAP_READ, 0, 0, 0);
+            map->size = size.QuadPart;
+            if (map->data)
+                return true;
+            CloseHandle(map->mapping);
+        }
+    }
+    CloseHandle(map->file);
+    return false;
+}
+static void nvg_file_unmap(NVGfileMap* map)
+{
+    UnmapViewOfFile(map->data);
+    CloseHandle(map->mapping);
+    CloseHandle(map->file);
+}
+// Replaces 'dst' if it exists
+static bool nvg_file_rename(const char* src, const char* dst)
+{
+    return MoveFileExA(src, dst, MOVEFILE_REPLACE_EXISTING) != 0;
+}
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+static bool nvg_file_map(NVGfileMap* map, const char* path)
+{
+    memset(map, 0, sizeof(*map));
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0)
+    {
+        void* ptr = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (ptr != MAP_FAILED)
+        {
+            map->data = ptr;
+            map->size = st.st_size;
+        }
+    }
+    close(fd); // The mapping keeps the file open
+    return map->data != NULL;
+}
+static void nvg_file_unmap(NVGfileMap* map) { munmap((void*)map->data, map->size); }
+// Replaces 'dst' if it exists
+static bool nvg_file_rename(const char* src, const char* dst) { return rename(src, dst) == 0; }
+#endif
+
 // #define FONTSTASH_IMPLEMENTATION
 // #include "fontstash.h"
 
@@ -267,13 +406,18 @@ void main(void) {
 #define NVG_INIT_FONTIMAGE_SIZE 512
 #define NVG_MAX_FONTIMAGE_SIZE  2048
 
-#define NVG_INIT_COMMANDS_SIZE 256
-#define NVG_INIT_POINTS_SIZE   128
-#define NVG_INIT_PATHS_SIZE    16
-#define NVG_INIT_VERTS_SIZE    256
+#define NVG_INIT_COMMANDS_SIZE  256
+#define NVG_INIT_POINTS_SIZE    128
+#define NVG_INIT_PATHS_SIZE     16
+#define NVG_INIT_VERTS_SIZE     256
+#define NVG_INIT_TEXT_SBO_SIZE  1024 // In glyphs
+#define NVG_INIT_FRAG_SBO_SIZE  256  // In SGNVGfragUniforms
+#define NVG_INIT_SHAPE_SBO_SIZE 256  // In SGNVGshape
 
 #define NVG_KAPPA90 0.5522847493f // Length proportional to radius of a cubic bezier handle for 90deg arcs.
 
+#define NVG_MAX_BEZIER_SEGMENTS 1024 // The same as 10 levels of recursive subdivision
+
 #define NVG_ASSERT_GOTO(cond, label)                                                                                   \
     NVG_ASSERT(cond);                                                                                                  \
     if (!(cond))                                                                                                       \
@@ -291,16 +435,26 @@ void main(void) {
 #define NVG_FREE(ptr)        free(ptr)
 #endif
 
-#if defined(NVG_FONT_FREETYPE_SINGLECHANNEL) || defined(NVG_FONT_FREETYPE_MULTICHANNEL)
+#if defined(NVG_FONT_FREETYPE)
 #include <ft2build.h>
 #include FT_FREETYPE_H
 #include FT_ADVANCES_H
 #endif
+#if defined(NVG_FONT_FREETYPE_SDF)
+#include FT_MODULE_H
+#endif
 
 enum
 {
-#if defined(NVG_FONT_FREETYPE_SINGLECHANNEL) || defined(NVG_FONT_FREETYPE_MULTICHANNEL)
-#if defined(NVG_FONT_FREETYPE_SINGLECHANNEL)
+#if defined(NVG_FONT_FREETYPE)
+#if defined(NVG_FONT_FREETYPE_SDF)
+    NVG_FT_RENDER_MODE       = FT_RENDER_MODE_SDF,
+    NVG_FT_LOAD              = FT_LOAD_RENDER | FT_LOAD_NO_HINTING | FT_LOAD_TARGET_(FT_RENDER_MODE_SDF),
+    NVG_FT_PIXEL_MODE        = FT_PIXEL_MODE_GRAY,
+    NVG_FT_BITMAP_CHANNELS   = 1,
+    NVG_GLYPH_ATLAS_CHANNELS = 1,
+    NVG_SG_PIXEL_FORMAT      = SG_PIXELFORMAT_R8,
+#elif defined(NVG_FONT_FREETYPE_SINGLECHANNEL)
     NVG_FT_RENDER_MODE       = FT_RENDER_MODE_NORMAL,
     NVG_FT_LOAD              = FT_LOAD_RENDER | FT_LOAD_FORCE_AUTOHINT | FT_LOAD_TARGET_NORMAL,
     NVG_FT_PIXEL_MODE        = FT_PIXEL_MODE_GRAY,
@@ -315,7 +469,7 @@ enum
     NVG_GLYPH_ATLAS_CHANNELS = 4,
     NVG_SG_PIXEL_FORMAT      = SG_PIXELFORMAT_RGBA8,
 #endif
-#endif // NVG_FONT_FREETYPE_SINGLECHANNEL || NVG_FONT_FREETYPE_MULTICHANNEL
+#endif // NVG_FONT_FREETYPE
 
 #ifdef NVG_FONT_STB_TRUETYPE
     NVG_GLYPH_ATLAS_CHANNELS = 1,
@@ -331,6 +485,7 @@ enum
     RECTPACK_PADDING = 1,
 };
 _Static_assert(NVG_ATLAS_WIDTH <= (1llu << 16), "");
+_Static_assert(NVG_ATLAS_WIDTH == 256 && NVG_ATLAS_HEIGHT == 256, "text.glsl packs atlas rects into 8 bits");
 _Static_assert((NVG_ATLAS_WIDTH << NVG_ATLAS_UINT16_SHIFT) == (1 << 16), "");
 
 static float nvg__sqrtf(float a) { return sqrtf(a); }
@@ -1108,6 +1263,7 @@ void nvg__appendCommands(NVGcontext* ctx, float* vals, int nvals)
             i += 3;
             break;
         case NVG_LINETO:
+        case NVG_SMOOTHTO:
             nvgTransformPoint(&vals[i + 1], &vals[i + 2], state->xform, vals[i + 1], vals[i + 2]);
             i += 3;
             break;
@@ -1168,6 +1324,22 @@ static NVGpoint* nvg__lastPoint(NVGcontext* ctx)
     return NULL;
 }
 
+// Makes room for 'n' more points in the path cache. Returns false if the allocation failed
+static bool nvg__reservePoints(NVGcontext* ctx, int n)
+{
+    if (ctx->cache.npoints + n > ctx->cache.cpoints)
+    {
+        NVGpoint* points;
+        int       cpoints = ctx->cache.npoints + n + ctx->cache.cpoints / 2;
+        points            = (NVGpoint*)NVG_REALLOC(ctx->cache.points, sizeof(NVGpoint) * cpoints);
+        if (points == NULL)
+            return false;
+        ctx->cache.points  = points;
+        ctx->cache.cpoints = cpoints;
+    }
+    return true;
+}
+
 static void nvg__addPoint(NVGcontext* ctx, float x, float y, int flags)
 {
     NVGpath*  path = nvg__lastPath(ctx);
@@ -1185,16 +1357,8 @@ static void nvg__addPoint(NVGcontext* ctx, float x, float y, int flags)
         }
     }
 
-    if (ctx->cache.npoints + 1 > ctx->cache.cpoints)
-    {
-        NVGpoint* points;
-        int       cpoints = ctx->cache.npoints + 1 + ctx->cache.cpoints / 2;
-        points            = (NVGpoint*)NVG_REALLOC(ctx->cache.points, sizeof(NVGpoint) * cpoints);
-        if (points == NULL)
-            return;
-        ctx->cache.points  = points;
-        ctx->cache.cpoints = cpoints;
-    }
+    if (!nvg__reservePoints(ctx, 1))
+        return;
 
     pt = &ctx->cache.points[ctx->cache.npoints];
     memset(pt, 0, sizeof(*pt));
@@ -1290,7 +1454,10 @@ static void nvg__vset(NVGvertex* vtx, float x, float y, float u, float v)
     vtx->v = v;
 }
 
-static void nvg__tesselateBezier(
+// Flattens the cubic bezier from (x1, y1) into line segments, appending their points to the current path.
+// Wang's formula gives the number of even steps in t that keeps the segments within tessTol of the curve, so there's no
+// recursion, and every point is reserved up front. Points are evaluated 4 at a time from the polynomial form
+static void nvg__flattenBezier(
     NVGcontext* ctx,
     float       x1,
     float       y1,
@@ -1300,46 +1467,104 @@ static void nvg__tesselateBezier(
     float       y3,
     float       x4,
     float       y4,
-    int         level,
     int         type)
 {
-    float x12, y12, x23, y23, x34, y34, x123, y123, x234, y234, x1234, y1234;
-    float dx, dy, d2, d3;
-
-    if (level > 10)
+    NVGpath* path = nvg__lastPath(ctx);
+    if (path == NULL)
         return;
 
-    x12  = (x1 + x2) * 0.5f;
-    y12  = (y1 + y2) * 0.5f;
-    x23  = (x2 + x3) * 0.5f;
-    y23  = (y2 + y3) * 0.5f;
-    x34  = (x3 + x4) * 0.5f;
-    y34  = (y3 + y4) * 0.5f;
-    x123 = (x12 + x23) * 0.5f;
-    y123 = (y12 + y23) * 0.5f;
+    // Wang's formula for cubics: n = sqrt(3 * 2 / 8 * max(|P1 - 2P2 + P3|, |P2 - 2P3 + P4|) / tolerance)
+    const float ddx0 = x1 - 2 * x2 + x3;
+    const float ddy0 = y1 - 2 * y2 + y3;
+    const float ddx1 = x2 - 2 * x3 + x4;
+    const float ddy1 = y2 - 2 * y3 + y4;
+    const float dd   = sqrtf(nvg__maxf(ddx0 * ddx0 + ddy0 * ddy0, ddx1 * ddx1 + ddy1 * ddy1));
+    // Clamped before the cast, which is undefined for NaN & out of range values. Non finite curves get one segment
+    const float segs = isfinite(dd) ? ceilf(sqrtf(0.75f * dd / ctx->tessTol)) : 1;
+    const int   n    = (int)nvg__clampf(segs, 1, NVG_MAX_BEZIER_SEGMENTS);
+    if (!nvg__reservePoints(ctx, n))
+        return;
 
-    dx = x4 - x1;
-    dy = y4 - y1;
-    d2 = nvg__absf(((x2 - x4) * dy - (y2 - y4) * dx));
-    d3 = nvg__absf(((x3 - x4) * dy - (y3 - y4) * dx));
+    // B(t) = ((a * t + b) * t + c) * t + P1
+    const float ax = x4 - x1 + 3 * (x2 - x3);
+    const float ay = y4 - y1 + 3 * (y2 - y3);
+    const float bx = 3 * ddx0;
+    const float by = 3 * ddy0;
+    const float cx = 3 * (x2 - x1);
+    const float cy = 3 * (y2 - y1);
+    const float dt = 1.0f / n;
+
+    NVGpoint* pts     = ctx->cache.points;
+    int       npoints = ctx->cache.npoints;
+    NVGpoint* prev    = path->count > 0 && npoints > 0 ? &pts[npoints - 1] : NULL;
+
+#if defined(NVG_SIMD_SSE2)
+    const __m128 steps = _mm_setr_ps(0, 1, 2, 3);
+    const __m128 vdt   = _mm_set1_ps(dt);
+#elif defined(NVG_SIMD_NEON)
+    const float       steps_[4] = {0, 1, 2, 3};
+    const float32x4_t steps     = vld1q_f32(steps_);
+#endif
+    // The end point is added exactly below, rather than evaluated
+    for (int i = 1; i < n; i += 4)
+    {
+        float xs[4], ys[4];
+#if defined(NVG_SIMD_SSE2)
+        __m128 t = _mm_mul_ps(_mm_add_ps(_mm_set1_ps((float)i), steps), vdt);
+        __m128 x = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(ax), t), _mm_set1_ps(bx));
+        __m128 y = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(ay), t), _mm_set1_ps(by));
+        x        = _mm_add_ps(_mm_mul_ps(x, t), _mm_set1_ps(cx));
+        y        = _mm_add_ps(_mm_mul_ps(y, t), _mm_set1_ps(cy));
+        x        = _mm_add_ps(_mm_mul_ps(x, t), _mm_set1_ps(x1));
+        y        = _mm_add_ps(_mm_mul_ps(y, t), _mm_set1_ps(y1));
+        _mm_storeu_ps(xs, x);
+        _mm_storeu_ps(ys, y);
+#elif defined(NVG_SIMD_NEON)
+        float32x4_t t = vmulq_n_f32(vaddq_f32(vdupq_n_f32((float)i), steps), dt);
+        float32x4_t x = vmlaq_f32(vdupq_n_f32(bx), vdupq_n_f32(ax), t);
+        float32x4_t y = vmlaq_f32(vdupq_n_f32(by), vdupq_n_f32(ay), t);
+        x             = vmlaq_f32(vdupq_n_f32(cx), x, t);
+        y             = vmlaq_f32(vdupq_n_f32(cy), y, t);
+        x             = vmlaq_f32(vdupq_n_f32(x1), x, t);
+        y             = vmlaq_f32(vdupq_n_f32(y1), y, t);
+        vst1q_f32(xs, x);
+        vst1q_f32(ys, y);
+#else
+        for (int k = 0; k < 4; k++)
+        {
+            float t = (i + k) * dt;
+            xs[k]   = ((ax * t + bx) * t + cx) * t + x1;
+            ys[k]   = ((ay * t + by) * t + cy) * t + y1;
+        }
+#endif
+        const int num = nvg__mini(4, n - i);
+        for (int k = 0; k < num; k++)
+        {
+            // Skip points on top of the previous one, the same as nvg__addPoint()
+            if (prev != NULL && nvg__ptEquals(prev->x, prev->y, xs[k], ys[k], ctx->distTol))
+                continue;
+            prev = &pts[npoints++];
+            memset(prev, 0, sizeof(*prev));
+            prev->x = xs[k];
+            prev->y = ys[k];
+        }
+    }
 
-    if ((d2 + d3) * (d2 + d3) < ctx->tessTol * (dx * dx + dy * dy))
+    if (prev != NULL && nvg__ptEquals(prev->x, prev->y, x4, y4, ctx->distTol))
     {
-        nvg__addPoint(ctx, x4, y4, type);
-        return;
+        prev->flags |= type;
+    }
+    else
+    {
+        prev = &pts[npoints++];
+        memset(prev, 0, sizeof(*prev));
+        prev->x     = x4;
+        prev->y     = y4;
+        prev->flags = (unsigned char)type;
     }
 
-    /*	if (nvg__absf(x1+x3-x2-x2) + nvg__absf(y1+y3-y2-y2) + nvg__absf(x2+x4-x3-x3) + nvg__absf(y2+y4-y3-y3) <
-       ctx->tessTol) { nvg__addPoint(ctx, x4, y4, type); return;
-            }*/
-
-    x234  = (x23 + x34) * 0.5f;
-    y234  = (y23 + y34) * 0.5f;
-    x1234 = (x123 + x234) * 0.5f;
-    y1234 = (y123 + y234) * 0.5f;
-
-    nvg__tesselateBezier(ctx, x1, y1, x12, y12, x123, y123, x1234, y1234, level + 1, 0);
-    nvg__tesselateBezier(ctx, x1234, y1234, x234, y234, x34, y34, x4, y4, level + 1, type);
+    path->count        += npoints - ctx->cache.npoints;
+    ctx->cache.npoints  = npoints;
 }
 
 static void nvg__flattenPaths(NVGcontext* ctx)
@@ -1378,6 +1603,11 @@ static void nvg__flattenPaths(NVGcontext* ctx)
             nvg__addPoint(ctx, p[0], p[1], NVG_PT_CORNER);
             i += 3;
             break;
+        case NVG_SMOOTHTO:
+            p = &ctx->commands[i + 1];
+            nvg__addPoint(ctx, p[0], p[1], 0);
+            i += 3;
+            break;
         case NVG_BEZIERTO:
             last = nvg__lastPoint(ctx);
             if (last != NULL)
@@ -1385,7 +1615,7 @@ static void nvg__flattenPaths(NVGcontext* ctx)
                 cp1 = &ctx->commands[i + 1];
                 cp2 = &ctx->commands[i + 3];
                 p   = &ctx->commands[i + 5];
-                nvg__tesselateBezier(
+                nvg__flattenBezier(
                     ctx,
                     last->x,
                     last->y,
@@ -1395,7 +1625,6 @@ static void nvg__flattenPaths(NVGcontext* ctx)
                     cp2[1],
                     p[0],
                     p[1],
-                    0,
                     NVG_PT_CORNER);
             }
             i += 7;
@@ -1990,12 +2219,13 @@ static int nvg__expandStroke(NVGcontext* ctx, float w, float fringe, int lineCap
     return 1;
 }
 
-static int nvg__expandFill(NVGcontext* ctx, float w, int lineJoin, float miterLimit)
+// 'convex' fills are drawn without stenciling, so only get half a fringe
+static int nvg__expandFill(NVGcontext* ctx, float w, int lineJoin, float miterLimit, int convex)
 {
     NVGpathCache* cache = &ctx->cache;
     NVGvertex*    verts;
     NVGvertex*    dst;
-    int           cverts, convex, i, j;
+    int           cverts, i, j;
     float         aa     = ctx->fringeWidth;
     int           fringe = w > 0.0f;
 
@@ -2015,8 +2245,6 @@ static int nvg__expandFill(NVGcontext* ctx, float w, int lineJoin, float miterLi
     if (verts == NULL)
         return 0;
 
-    convex = cache->npaths == 1 && cache->paths[0].convex;
-
     for (i = 0; i < cache->npaths; i++)
     {
         NVGpath*  path = &cache->paths[i];
@@ -2140,12 +2368,140 @@ static int nvg__expandFill(NVGcontext* ctx, float w, int lineJoin, float miterLi
     return 1;
 }
 
+static int* nvg__allocTempTris(NVGcontext* ctx, int ntris)
+{
+    if (ntris > ctx->cache.ctris)
+    {
+        int* tris;
+        int  ctris = (ntris + 0xff) & ~0xff; // Round up to prevent allocations when things change just slightly.
+        tris       = (int*)NVG_REALLOC(ctx->cache.tris, sizeof(int) * ctris);
+        if (tris == NULL)
+            return NULL;
+        ctx->cache.tris  = tris;
+        ctx->cache.ctris = ctris;
+    }
+
+    return ctx->cache.tris;
+}
+
+// Segments ab & cd cross at a point inside both. Touching doesn't count
+static int nvg__segmentsCross(const NVGvertex* a, const NVGvertex* b, const NVGvertex* c, const NVGvertex* d)
+{
+    float abc = nvg__triarea2(a->x, a->y, b->x, b->y, c->x, c->y);
+    float abd = nvg__triarea2(a->x, a->y, b->x, b->y, d->x, d->y);
+    float cda = nvg__triarea2(c->x, c->y, d->x, d->y, a->x, a->y);
+    float cdb = nvg__triarea2(c->x, c->y, d->x, d->y, b->x, b->y);
+    return ((abc > 0 && abd < 0) || (abc < 0 && abd > 0)) && ((cda > 0 && cdb < 0) || (cda < 0 && cdb > 0));
+}
+
+static int nvg__polySelfIntersects(const NVGvertex* v, int n)
+{
+    for (int i = 0; i < n; i++)
+    {
+        // Neighbouring edges share a corner, so start 2 edges on. The last edge neighbours the first
+        for (int j = i + 2; j < n - (i == 0); j++)
+            if (nvg__segmentsCross(&v[i], &v[(i + 1) % n], &v[j], &v[(j + 1) % n]))
+                return 1;
+    }
+    return 0;
+}
+
+// Corner i of the outline linked by 'next' can be clipped off. 'sign' makes convex corners positive
+static int nvg__isEar(const NVGvertex* v, const int* next, int p, int i, int nx, float sign)
+{
+    const NVGvertex* a    = &v[p];
+    const NVGvertex* b    = &v[i];
+    const NVGvertex* c    = &v[nx];
+    float            area = nvg__triarea2(a->x, a->y, b->x, b->y, c->x, c->y) * sign;
+
+    if (area < 0.0f)
+        return 0; // Reflex corner
+    if (area == 0.0f)
+        return 1; // Collinear. Clipping it only drops a zero area triangle
+
+    // No other corner may lie inside the ear. Corners sharing a position with the ear's come from bevels & are skipped
+    for (int j = next[nx]; j != p; j = next[j])
+    {
+        const NVGvertex* q = &v[j];
+        if ((q->x == a->x && q->y == a->y) || (q->x == b->x && q->y == b->y) || (q->x == c->x && q->y == c->y))
+            continue;
+        if (nvg__triarea2(a->x, a->y, b->x, b->y, q->x, q->y) * sign >= 0.0f &&
+            nvg__triarea2(b->x, b->y, c->x, c->y, q->x, q->y) * sign >= 0.0f &&
+            nvg__triarea2(c->x, c->y, a->x, a->y, q->x, q->y) * sign >= 0.0f)
+            return 0;
+    }
+    return 1;
+}
+
+// Ear clips the fill outline of 'path' into cache.tris, as triangles of indexes relative to path->fill. Returns the
+// number of indexes, or 0 if the outline is too long, crosses itself or has no ear left to clip
+static int nvg__triangulateFill(NVGcontext* ctx, const NVGpath* path)
+{
+    const NVGvertex* v         = path->fill;
+    const int        n         = path->nfill;
+    int              ntris     = 0;
+    int              remaining = n;
+    int              guard     = 0;
+    float            area      = 0.0f;
+    int*             tris;
+    int*             prev;
+    int*             next;
+    int              i;
+
+    if (n < 3 || n > NVG_MAX_TRIANGULATE_VERTS || nvg__polySelfIntersects(v, n))
+        return 0;
+    tris = nvg__allocTempTris(ctx, (n - 2) * 3 + n * 2);
+    if (tris == NULL)
+        return 0;
+    prev = tris + (n - 2) * 3;
+    next = prev + n;
+
+    // Either winding works. The sign of the area tells convex corners from reflex ones
+    for (i = 2; i < n; i++)
+        area += nvg__triarea2(v[0].x, v[0].y, v[i - 1].x, v[i - 1].y, v[i].x, v[i].y);
+    for (i = 0; i < n; i++)
+    {
+        prev[i] = i == 0 ? n - 1 : i - 1;
+        next[i] = i == n - 1 ? 0 : i + 1;
+    }
+
+    i = 0;
+    while (remaining > 3)
+    {
+        int p  = prev[i];
+        int nx = next[i];
+        if (nvg__isEar(v, next, p, i, nx, area < 0.0f ? -1.0f : 1.0f))
+        {
+            tris[ntris++] = p;
+            tris[ntris++] = i;
+            tris[ntris++] = nx;
+            next[p]       = nx;
+            prev[nx]      = p;
+            remaining--;
+            guard = 0;
+            i     = p; // Clipping may have made p an ear
+        }
+        else
+        {
+            i = nx;
+            if (++guard > remaining)
+                return 0; // Went all the way round without an ear
+        }
+    }
+    tris[ntris++] = prev[i];
+    tris[ntris++] = i;
+    tris[ntris++] = next[i];
+
+    return ntris;
+}
+
 // Draw
 void nvgBeginPath(NVGcontext* ctx)
 {
-    ctx->ncommands     = 0;
-    ctx->cache.npoints = 0;
-    ctx->cache.npaths  = 0;
+    ctx->ncommands            = 0;
+    ctx->cache.npoints        = 0;
+    ctx->cache.npaths         = 0;
+    ctx->shape_hint.ncommands = 0;
 }
 
 void nvgQuadTo(NVGcontext* ctx, float cx, float cy, float x, float y)
@@ -2231,14 +2587,45 @@ void nvgSetPathWinding(NVGcontext* ctx, int dir)
     nvg__appendCommands(ctx, vals, NVG_ARRLEN(vals));
 }
 
+_Static_assert((NVG_MAX_CIRCLE_SEGMENTS & (NVG_MAX_CIRCLE_SEGMENTS - 1)) == 0, "Must be a power of 2");
+
+// Segments for a full circle of radius 'r' in the current transform, keeping each chord within tessTol of the circle.
+// A power of 2 between 8 and NVG_MAX_CIRCLE_SEGMENTS, so every LOD is a stride through ctx->unit_circle
+static int nvg__circleSegments(NVGcontext* ctx, float r)
+{
+    const float r_px = nvg__absf(r) * nvg__getAverageScale(ctx->state.xform);
+    // Chord error is r * (1 - cos(pi / n)), roughly r * pi^2 / (2 * n^2)
+    const float min_segments = NVG_PI * sqrtf(r_px / (2 * ctx->tessTol));
+
+    int n = 8;
+    while (n < min_segments && n < NVG_MAX_CIRCLE_SEGMENTS)
+        n *= 2;
+    return n;
+}
+
+// Writes NVG_SMOOTHTO commands for the points of an elliptic arc around cx, cy. 'k0' & 'k1' are indexes around a circle
+// of 'n' segments, and may be negative. The arc steps from k0 towards k1, excluding both. Returns the number of floats
+static int nvg__writeArcPoints(NVGcontext* ctx, float* vals, float cx, float cy, float rx, float ry, int n, int k0, int k1)
+{
+    const int stride = NVG_MAX_CIRCLE_SEGMENTS / n;
+    const int dir    = k1 > k0 ? 1 : -1;
+    int       nvals  = 0;
+    for (int k = k0 + dir; k != k1; k += dir)
+    {
+        const float* pt = ctx->unit_circle + (k & (n - 1)) * stride * 2;
+        vals[nvals++]   = NVG_SMOOTHTO;
+        vals[nvals++]   = cx + pt[0] * rx;
+        vals[nvals++]   = cy + pt[1] * ry;
+    }
+    return nvals;
+}
+
 void nvgArc(NVGcontext* ctx, float cx, float cy, float r, float a0, float a1, int dir)
 {
-    float a = 0, da = 0, hda = 0, kappa = 0;
-    float dx = 0, dy = 0, x = 0, y = 0, tanx = 0, tany = 0;
-    float px = 0, py = 0, ptanx = 0, ptany = 0;
-    float vals[3 + 5 * 7 + 100];
-    int   i, ndivs, nvals;
-    int   move = ctx->ncommands > 0 ? NVG_LINETO : NVG_MOVETO;
+    float da = 0;
+    float vals[3 * (NVG_MAX_CIRCLE_SEGMENTS + 3)];
+    int   nvals = 0;
+    int   move  = ctx->ncommands > 0 ? NVG_LINETO : NVG_MOVETO;
 
     // Clamp angles
     da = a1 - a0;
@@ -2268,62 +2655,83 @@ void nvgArc(NVGcontext* ctx, float cx, float cy, float r, float a0, float a1, in
                 da -= NVG_PI * 2;
         }
     }
+    a1 = a0 + da;
 
-    // Split arc into max 90 degree segments.
-    ndivs = nvg__maxi(1, nvg__mini((int)(nvg__absf(da) / (NVG_PI * 0.5f) + 0.5f), 5));
-    hda   = (da / (float)ndivs) / 2.0f;
-    kappa = nvg__absf(4.0f / 3.0f * (1.0f - nvg__cosf(hda)) / nvg__sinf(hda));
-
-    if (dir == NVG_CCW)
-        kappa = -kappa;
-
-    nvals = 0;
-    for (i = 0; i <= ndivs; i++)
+    // The ends are exact. Points in between come from the unit circle table, at the nearest indexes inside the arc.
+    // Indexes within a quarter step of an end are skipped to avoid a sliver of a segment there
+    const int   n    = nvg__circleSegments(ctx, r);
+    const float step = NVG_PI * 2 / n;
+    int         k0, k1;
+    if (da > 0)
     {
-        a    = a0 + da * (i / (float)ndivs);
-        dx   = nvg__cosf(a);
-        dy   = nvg__sinf(a);
-        x    = cx + dx * r;
-        y    = cy + dy * r;
-        tanx = -dy * r * kappa;
-        tany = dx * r * kappa;
-
-        if (i == 0)
-        {
-            vals[nvals++] = (float)move;
-            vals[nvals++] = x;
-            vals[nvals++] = y;
-        }
-        else
-        {
-            vals[nvals++] = NVG_BEZIERTO;
-            vals[nvals++] = px + ptanx;
-            vals[nvals++] = py + ptany;
-            vals[nvals++] = x - tanx;
-            vals[nvals++] = y - tany;
-            vals[nvals++] = x;
-            vals[nvals++] = y;
-        }
-        px    = x;
-        py    = y;
-        ptanx = tanx;
-        ptany = tany;
+        k0 = (int)floorf(a0 / step + 0.25f);
+        k1 = (int)ceilf(a1 / step - 0.25f);
     }
+    else
+    {
+        k0 = (int)ceilf(a0 / step - 0.25f);
+        k1 = (int)floorf(a1 / step + 0.25f);
+    }
+
+    vals[nvals++] = (float)move;
+    vals[nvals++] = cx + nvg__cosf(a0) * r;
+    vals[nvals++] = cy + nvg__sinf(a0) * r;
+    if (da > 0 ? k0 < k1 : k0 > k1)
+        nvals += nvg__writeArcPoints(ctx, vals + nvals, cx, cy, r, r, n, k0, k1);
+    vals[nvals++] = NVG_LINETO;
+    vals[nvals++] = cx + nvg__cosf(a1) * r;
+    vals[nvals++] = cy + nvg__sinf(a1) * r;
 
     nvg__appendCommands(ctx, vals, nvals);
 }
 
+// Call after appending a shape that started the path. Marks the path as drawable by nvg__drawShape() when the
+// transform keeps it an axis aligned rect with circular corners. 'radii' is top left, top right, bottom right, bottom
+// left, or NULL for square corners
+static void
+nvg__setShapeHint(NVGcontext* ctx, float left, float top, float right, float bottom, const float* radii)
+{
+    const float* t     = ctx->state.xform;
+    const float  halfw = (right - left) * 0.5f;
+    const float  halfh = (bottom - top) * 0.5f;
+
+    if (halfw <= 0.0f || halfh <= 0.0f)
+        return;
+    // No rotation or skew, and the same positive scale on both axes
+    if (t[1] != 0.0f || t[2] != 0.0f || t[0] <= 0.0f || nvg__absf(t[0] - t[3]) > t[0] * 1e-4f)
+        return;
+    for (int i = 0; radii != NULL && i < 4; i++)
+        if (radii[i] < 0.0f || radii[i] > nvg__minf(halfw, halfh) * 1.0001f)
+            return; // Elliptical corner
+
+    ctx->shape_hint.ncommands = ctx->ncommands;
+    ctx->shape_hint.rect[0]   = t[0] * left + t[4];
+    ctx->shape_hint.rect[1]   = t[3] * top + t[5];
+    ctx->shape_hint.rect[2]   = t[0] * (right - left);
+    ctx->shape_hint.rect[3]   = t[3] * (bottom - top);
+    for (int i = 0; i < 4; i++)
+        ctx->shape_hint.radii[i] = radii != NULL ? radii[i] * t[0] : 0.0f;
+}
+
 void nvgRect(NVGcontext* ctx, float x, float y, float w, float h)
 {
+    const bool first = ctx->ncommands == 0;
+
     float vals[] = {NVG_MOVETO, x, y, NVG_LINETO, x, y + h, NVG_LINETO, x + w, y + h, NVG_LINETO, x + w, y, NVG_CLOSE};
     nvg__appendCommands(ctx, vals, NVG_ARRLEN(vals));
+    if (first)
+        nvg__setShapeHint(ctx, x, y, x + w, y + h, NULL);
 }
 
 void nvgRect2(NVGcontext* ctx, float left, float top, float right, float bottom)
 {
+    const bool first = ctx->ncommands == 0;
+
     float vals[] =
         {NVG_MOVETO, left, top, NVG_LINETO, left, bottom, NVG_LINETO, right, bottom, NVG_LINETO, right, top, NVG_CLOSE};
     nvg__appendCommands(ctx, vals, NVG_ARRLEN(vals));
+    if (first)
+        nvg__setShapeHint(ctx, left, top, right, bottom, NULL);
 }
 
 void nvgRoundedRect(NVGcontext* ctx, float x, float y, float w, float h, float r)
@@ -2331,6 +2739,78 @@ void nvgRoundedRect(NVGcontext* ctx, float x, float y, float w, float h, float r
     nvgRoundedRectVarying(ctx, x, y, w, h, r, r, r, r);
 }
 
+// Appends a rounded rect from its edges & the radii of each corner. The corners are quarter ellipses from the unit circle
+static void nvg__roundedRectPath(
+    NVGcontext* ctx,
+    float       left,
+    float       top,
+    float       right,
+    float       bottom,
+    float       rxTL,
+    float       ryTL,
+    float       rxTR,
+    float       ryTR,
+    float       rxBR,
+    float       ryBR,
+    float       rxBL,
+    float       ryBL)
+{
+    const bool first = ctx->ncommands == 0;
+    float      vals[3 * NVG_MAX_CIRCLE_SEGMENTS + 32];
+    int        nvals = 0;
+    int        n;
+
+    vals[nvals++] = NVG_MOVETO;
+    vals[nvals++] = left;
+    vals[nvals++] = top + ryTL;
+    vals[nvals++] = NVG_LINETO;
+    vals[nvals++] = left;
+    vals[nvals++] = bottom - ryBL;
+
+    // Angles in quarter turns of n: 0 is right, n / 4 is down
+    n      = nvg__circleSegments(ctx, nvg__maxf(nvg__absf(rxBL), nvg__absf(ryBL)));
+    nvals += nvg__writeArcPoints(ctx, vals + nvals, left + rxBL, bottom - ryBL, rxBL, ryBL, n, n / 2, n / 4);
+    vals[nvals++] = NVG_LINETO;
+    vals[nvals++] = left + rxBL;
+    vals[nvals++] = bottom;
+    vals[nvals++] = NVG_LINETO;
+    vals[nvals++] = right - rxBR;
+    vals[nvals++] = bottom;
+
+    n      = nvg__circleSegments(ctx, nvg__maxf(nvg__absf(rxBR), nvg__absf(ryBR)));
+    nvals += nvg__writeArcPoints(ctx, vals + nvals, right - rxBR, bottom - ryBR, rxBR, ryBR, n, n / 4, 0);
+    vals[nvals++] = NVG_LINETO;
+    vals[nvals++] = right;
+    vals[nvals++] = bottom - ryBR;
+    vals[nvals++] = NVG_LINETO;
+    vals[nvals++] = right;
+    vals[nvals++] = top + ryTR;
+
+    n      = nvg__circleSegments(ctx, nvg__maxf(nvg__absf(rxTR), nvg__absf(ryTR)));
+    nvals += nvg__writeArcPoints(ctx, vals + nvals, right - rxTR, top + ryTR, rxTR, ryTR, n, 0, -n / 4);
+    vals[nvals++] = NVG_LINETO;
+    vals[nvals++] = right - rxTR;
+    vals[nvals++] = top;
+    vals[nvals++] = NVG_LINETO;
+    vals[nvals++] = left + rxTL;
+    vals[nvals++] = top;
+
+    n      = nvg__circleSegments(ctx, nvg__maxf(nvg__absf(rxTL), nvg__absf(ryTL)));
+    nvals += nvg__writeArcPoints(ctx, vals + nvals, left + rxTL, top + ryTL, rxTL, ryTL, n, -n / 4, -n / 2);
+    vals[nvals++] = NVG_LINETO;
+    vals[nvals++] = left;
+    vals[nvals++] = top + ryTL;
+    vals[nvals++] = NVG_CLOSE;
+
+    nvg__appendCommands(ctx, vals, nvals);
+
+    if (first && rxTL == ryTL && rxTR == ryTR && rxBR == ryBR && rxBL == ryBL)
+    {
+        const float radii[4] = {rxTL, rxTR, rxBR, rxBL};
+        nvg__setShapeHint(ctx, left, top, right, bottom, radii);
+    }
+}
+
 void nvgRoundedRectVarying(
     NVGcontext* ctx,
     float       x,
@@ -2358,52 +2838,7 @@ void nvgRoundedRectVarying(
         float rxTR  = nvg__minf(radTopRight, halfw) * nvg__signf(w),
               ryTR  = nvg__minf(radTopRight, halfh) * nvg__signf(h);
         float rxTL = nvg__minf(radTopLeft, halfw) * nvg__signf(w), ryTL = nvg__minf(radTopLeft, halfh) * nvg__signf(h);
-        float vals[] = {
-            NVG_MOVETO,
-            x,
-            y + ryTL,
-            NVG_LINETO,
-            x,
-            y + h - ryBL,
-            NVG_BEZIERTO,
-            x,
-            y + h - ryBL * (1 - NVG_KAPPA90),
-            x + rxBL * (1 - NVG_KAPPA90),
-            y + h,
-            x + rxBL,
-            y + h,
-            NVG_LINETO,
-            x + w - rxBR,
-            y + h,
-            NVG_BEZIERTO,
-            x + w - rxBR * (1 - NVG_KAPPA90),
-            y + h,
-            x + w,
-            y + h - ryBR * (1 - NVG_KAPPA90),
-            x + w,
-            y + h - ryBR,
-            NVG_LINETO,
-            x + w,
-            y + ryTR,
-            NVG_BEZIERTO,
-            x + w,
-            y + ryTR * (1 - NVG_KAPPA90),
-            x + w - rxTR * (1 - NVG_KAPPA90),
-            y,
-            x + w - rxTR,
-            y,
-            NVG_LINETO,
-            x + rxTL,
-            y,
-            NVG_BEZIERTO,
-            x + rxTL * (1 - NVG_KAPPA90),
-            y,
-            x,
-            y + ryTL * (1 - NVG_KAPPA90),
-            x,
-            y + ryTL,
-            NVG_CLOSE};
-        nvg__appendCommands(ctx, vals, NVG_ARRLEN(vals));
+        nvg__roundedRectPath(ctx, x, y, x + w, y + h, rxTL, ryTL, rxTR, ryTR, rxBR, ryBR, rxBL, ryBL);
     }
 }
 
@@ -2436,52 +2871,7 @@ void nvgRoundedRectVarying2(
         float rxTR  = nvg__minf(radTopRight, halfw) * nvg__signf(w),
               ryTR  = nvg__minf(radTopRight, halfh) * nvg__signf(h);
         float rxTL = nvg__minf(radTopLeft, halfw) * nvg__signf(w), ryTL = nvg__minf(radTopLeft, halfh) * nvg__signf(h);
-        float vals[] = {
-            NVG_MOVETO,
-            x,
-            y + ryTL,
-            NVG_LINETO,
-            x,
-            b - ryBL,
-            NVG_BEZIERTO,
-            x,
-            b - ryBL * (1 - NVG_KAPPA90),
-            x + rxBL * (1 - NVG_KAPPA90),
-            b,
-            x + rxBL,
-            b,
-            NVG_LINETO,
-            r - rxBR,
-            b,
-            NVG_BEZIERTO,
-            r - rxBR * (1 - NVG_KAPPA90),
-            b,
-            r,
-            b - ryBR * (1 - NVG_KAPPA90),
-            r,
-            b - ryBR,
-            NVG_LINETO,
-            r,
-            y + ryTR,
-            NVG_BEZIERTO,
-            r,
-            y + ryTR * (1 - NVG_KAPPA90),
-            r - rxTR * (1 - NVG_KAPPA90),
-            y,
-            r - rxTR,
-            y,
-            NVG_LINETO,
-            x + rxTL,
-            y,
-            NVG_BEZIERTO,
-            x + rxTL * (1 - NVG_KAPPA90),
-            y,
-            x,
-            y + ryTL * (1 - NVG_KAPPA90),
-            x,
-            y + ryTL,
-            NVG_CLOSE};
-        nvg__appendCommands(ctx, vals, NVG_ARRLEN(vals));
+        nvg__roundedRectPath(ctx, x, y, r, b, rxTL, ryTL, rxTR, ryTR, rxBR, ryBR, rxBL, ryBL);
     }
 }
 
@@ -2492,40 +2882,24 @@ void nvgRoundedRect2(NVGcontext* ctx, float x, float y, float r, float b, float
 
 void nvgEllipse(NVGcontext* ctx, float cx, float cy, float rx, float ry)
 {
-    float vals[] = {
-        NVG_MOVETO,
-        cx - rx,
-        cy,
-        NVG_BEZIERTO,
-        cx - rx,
-        cy + ry * NVG_KAPPA90,
-        cx - rx * NVG_KAPPA90,
-        cy + ry,
-        cx,
-        cy + ry,
-        NVG_BEZIERTO,
-        cx + rx * NVG_KAPPA90,
-        cy + ry,
-        cx + rx,
-        cy + ry * NVG_KAPPA90,
-        cx + rx,
-        cy,
-        NVG_BEZIERTO,
-        cx + rx,
-        cy - ry * NVG_KAPPA90,
-        cx + rx * NVG_KAPPA90,
-        cy - ry,
-        cx,
-        cy - ry,
-        NVG_BEZIERTO,
-        cx - rx * NVG_KAPPA90,
-        cy - ry,
-        cx - rx,
-        cy - ry * NVG_KAPPA90,
-        cx - rx,
-        cy,
-        NVG_CLOSE};
-    nvg__appendCommands(ctx, vals, NVG_ARRLEN(vals));
+    const bool first = ctx->ncommands == 0;
+    float      vals[3 * NVG_MAX_CIRCLE_SEGMENTS + 8];
+    int        nvals = 0;
+    const int  n     = nvg__circleSegments(ctx, nvg__maxf(nvg__absf(rx), nvg__absf(ry)));
+
+    // Starts on the left & runs through the bottom, the same as nanovg's 4 beziers
+    vals[nvals++]  = NVG_MOVETO;
+    vals[nvals++]  = cx - rx;
+    vals[nvals++]  = cy;
+    nvals         += nvg__writeArcPoints(ctx, vals + nvals, cx, cy, rx, ry, n, n / 2, -n / 2);
+    vals[nvals++]  = NVG_CLOSE;
+    nvg__appendCommands(ctx, vals, nvals);
+
+    if (first && rx == ry)
+    {
+        const float radii[4] = {rx, rx, rx, rx};
+        nvg__setShapeHint(ctx, cx - rx, cy - ry, cx + rx, cy + ry, radii);
+    }
 }
 
 void nvgCircle(NVGcontext* ctx, float cx, float cy, float r) { nvgEllipse(ctx, cx, cy, r, r); }
@@ -2576,8 +2950,17 @@ int nvgCreateFontAtIndex(NVGcontext* ctx, const char* filename, const int fontIn
                 }
                 else
                 {
-                    font_id   = i + 1;
-                    sl->owned = 1;
+                    font_id        = i + 1;
+                    sl->owned      = 1;
+                    sl->face_index = fontIndex;
+#ifdef NVG_FONT_FREETYPE
+                    int err = FT_New_Memory_Face(ctx->ft_lib, sl->data, sl->data_size, fontIndex, &sl->ft_face);
+                    xassert(!err);
+
+                    sl->has_ascii = true;
+                    for (int c = 0x20; c < 0x7f && sl->has_ascii; c++)
+                        sl->has_ascii = FT_Get_Char_Index(sl->ft_face, c) != 0;
+#endif
                 }
             }
             break;
@@ -2656,7 +3039,7 @@ void nvgSetFontFaceById(NVGcontext* ctx, int font_id)
 {
     NVGstate* state    = &ctx->state;
     int       font_idx = font_id - 1;
-    bool      is_valid = font_idx >= 0 && font_id < NVG_ARRLEN(ctx->fonts);
+    bool      is_valid = font_idx >= 0 && font_idx < NVG_ARRLEN(ctx->fonts);
     NVG_ASSERT(is_valid);
     if (!is_valid)
         ctx->state.fontId = 0;
@@ -2667,8 +3050,9 @@ void nvgSetFontFaceById(NVGcontext* ctx, int font_id)
         NVGfontSlot* sl = &ctx->fonts[font_idx];
 
 #ifdef NVG_FONT_FREETYPE
-        int err = FT_New_Memory_Face(ctx->ft_lib, sl->data, sl->data_size, 0, &ctx->ft_face);
-        xassert(!err);
+        // Faces are created once per font slot. Switching fonts is only a pointer swap
+        xassert(sl->ft_face);
+        ctx->ft_face = sl->ft_face;
 
         FT_Fixed advance = 0;
         FT_Get_Advance(ctx->ft_face, 32, FT_LOAD_NO_SCALE, &advance);
@@ -2681,6 +3065,63 @@ void nvgSetFontFaceById(NVGcontext* ctx, int font_id)
     }
 }
 
+#ifdef NVG_FONT_FREETYPE
+// Activates the current font's FT_Size for 'font_size', creating one if necessary.
+// Replaces FT_Set_Pixel_Sizes(), which recomputes the scaled metrics on every call
+static const NVGfontSize* nvg__setFontPixelSize(NVGcontext* ctx, float font_size)
+{
+    xassert(ctx->state.fontId > 0);
+    NVGfontSlot* sl = ctx->fonts + ctx->state.fontId - 1;
+    xassert(sl->ft_face == ctx->ft_face);
+
+    // FT_Set_Pixel_Sizes() takes an integer, so sizes are truncated. Sizes under 1px use 1px
+    const uint32_t pixel_size = nvg__maxf(font_size, 1);
+    xassert(pixel_size > 0);
+
+    NVGfontSize* fs = NULL;
+    for (int i = 0; i < NVG_ARRLEN(sl->sizes); i++)
+    {
+        if (sl->sizes[i].pixel_size == pixel_size)
+        {
+            fs = sl->sizes + i;
+            break;
+        }
+    }
+
+    if (fs == NULL)
+    {
+        // Take an empty slot, or recycle the least recently used size
+        fs = sl->sizes;
+        for (int i = 0; i < NVG_ARRLEN(sl->sizes) && fs->pixel_size != 0; i++)
+            if (sl->sizes[i].pixel_size == 0 || sl->sizes[i].last_used_frame < fs->last_used_frame)
+                fs = sl->sizes + i;
+
+        if (fs->ft_size == NULL)
+        {
+            int err = FT_New_Size(sl->ft_face, &fs->ft_size);
+            xassert(!err);
+        }
+        FT_Activate_Size(fs->ft_size);
+        FT_Set_Pixel_Sizes(sl->ft_face, 0, pixel_size);
+
+        const FT_Size_Metrics* m = &fs->ft_size->metrics;
+        fs->pixel_size           = pixel_size;
+        fs->ascender             = m->ascender;
+        fs->descender            = m->descender;
+        fs->height               = m->height;
+        fs->x_scale              = m->x_scale;
+        fs->y_scale              = m->y_scale;
+    }
+    else if (sl->ft_face->size != fs->ft_size)
+    {
+        FT_Activate_Size(fs->ft_size);
+    }
+
+    fs->last_used_frame = ctx->frame_id;
+    return fs;
+}
+#endif
+
 // void nvgSetFontFaceByName(NVGcontext* ctx, const char* font)
 // {
 //     NVGstate* state = &ctx->state;
@@ -2747,135 +3188,939 @@ void nvgSetFontFaceById(NVGcontext* ctx, int font_id)
 //     return (det < 0);
 // }
 
+static void nvg__dirtyRectsAdd(NVGdirtyRects* dirty, int x, int y, int w, int h)
+{
+    int x0 = x, y0 = y, x1 = x + w, y1 = y + h;
+
+    int merge_idx = -1;
+    for (int i = 0; i < dirty->num && merge_idx < 0; i++)
+    {
+        const bool touching = x0 <= dirty->rects[i].x1 && dirty->rects[i].x0 <= x1 && y0 <= dirty->rects[i].y1 &&
+                              dirty->rects[i].y0 <= y1;
+        if (touching)
+            merge_idx = i;
+    }
+    if (merge_idx < 0 && dirty->num == NVG_ARRLEN(dirty->rects))
+    {
+        int best_growth = INT32_MAX;
+        for (int i = 0; i < dirty->num; i++)
+        {
+            int ux0    = xm_mini(dirty->rects[i].x0, x0);
+            int uy0    = xm_mini(dirty->rects[i].y0, y0);
+            int ux1    = xm_maxi(dirty->rects[i].x1, x1);
+            int uy1    = xm_maxi(dirty->rects[i].y1, y1);
+            int area   = (dirty->rects[i].x1 - dirty->rects[i].x0) * (dirty->rects[i].y1 - dirty->rects[i].y0);
+            int growth = (ux1 - ux0) * (uy1 - uy0) - area;
+            if (growth < best_growth)
+            {
+                best_growth = growth;
+                merge_idx   = i;
+            }
+        }
+    }
+
+    if (merge_idx >= 0)
+    {
+        // The grown region may now touch others, so add it again
+        x0 = xm_mini(dirty->rects[merge_idx].x0, x0);
+        y0 = xm_mini(dirty->rects[merge_idx].y0, y0);
+        x1 = xm_maxi(dirty->rects[merge_idx].x1, x1);
+        y1 = xm_maxi(dirty->rects[merge_idx].y1, y1);
+
+        dirty->rects[merge_idx] = dirty->rects[--dirty->num];
+        nvg__dirtyRectsAdd(dirty, x0, y0, x1 - x0, y1 - y0);
+    }
+    else
+    {
+        dirty->rects[dirty->num].x0 = x0;
+        dirty->rects[dirty->num].y0 = y0;
+        dirty->rects[dirty->num].x1 = x1;
+        dirty->rects[dirty->num].y1 = y1;
+        dirty->num++;
+    }
+}
+
+// Uploads the dirty regions of an image and clears them. No regions means upload the whole image.
+// Returns the number of bytes uploaded.
+// sokol_gfx can only replace whole mip levels. To upload only the dirty regions, define
+// NVG_UPDATE_IMAGE_REGION(img, x, y, w, h, ptr, row_stride) with a backend specific sub image update (eg.
+// glTexSubImage2D or ID3D11DeviceContext::UpdateSubresource). Glyph atlases don't need it, see nvg__stageAtlasUpload()
+static size_t
+nvg__uploadDirtyRects(sg_image img, const uint8_t* data, int width, int height, int bpp, NVGdirtyRects* dirty)
+{
+    const size_t row_stride = (size_t)width * bpp;
+    size_t       nbytes     = 0;
+#ifdef NVG_UPDATE_IMAGE_REGION
+    if (dirty->num)
+    {
+        for (int i = 0; i < dirty->num; i++)
+        {
+            int x0 = xm_maxi(dirty->rects[i].x0, 0);
+            int y0 = xm_maxi(dirty->rects[i].y0, 0);
+            int x1 = xm_mini(dirty->rects[i].x1, width);
+            int y1 = xm_mini(dirty->rects[i].y1, height);
+            if (x1 <= x0 || y1 <= y0)
+                continue;
+
+            const uint8_t* ptr = data + y0 * row_stride + x0 * bpp;
+            NVG_UPDATE_IMAGE_REGION(img, x0, y0, x1 - x0, y1 - y0, ptr, row_stride);
+            nbytes += (size_t)(x1 - x0) * (y1 - y0) * bpp;
+        }
+        dirty->num = 0;
+        return nbytes;
+    }
+#endif
+    nbytes = row_stride * height;
+    sg_update_image(img, &(sg_image_data){.mip_levels[0] = {data, nbytes}});
+    dirty->num = 0;
+    return nbytes;
+}
+
 NVGatlas glyph_atlas_new()
 {
     sg_image img = sg_make_image(&(sg_image_desc){
-        .width                = NVG_ATLAS_WIDTH,
-        .height               = NVG_ATLAS_HEIGHT,
-        .pixel_format         = NVG_SG_PIXEL_FORMAT,
-        .usage.dynamic_update = true,
+        .width                  = NVG_ATLAS_WIDTH,
+        .height                 = NVG_ATLAS_HEIGHT,
+        .pixel_format           = NVG_SG_PIXEL_FORMAT,
+        .usage.color_attachment = true,
     });
     xassert(img.id);
-    NVGatlas atlas = {.img_view = sg_make_view(&(sg_view_desc){.texture.image = img})};
+    NVGatlas atlas = {
+        .img         = img,
+        .img_view    = sg_make_view(&(sg_view_desc){.texture.image = img}),
+        .att_view    = sg_make_view(&(sg_view_desc){.color_attachment.image = img}),
+        .needs_clear = true,
+    };
     xassert(atlas.img_view.id);
+    xassert(atlas.att_view.id);
     return atlas;
 }
 
-#ifdef NVG_FONT_FREETYPE
-int nvg__renderGlyph(NVGcontext* ctx, uint32_t glyph_index, float font_size)
-{
-    int num_packed = 0;
+_Static_assert(NVG_ATLAS_UPLOAD_ROWS > 0 && NVG_ATLAS_UPLOAD_ROWS <= NVG_ATLAS_HEIGHT, "");
 
-    xassert(ctx->current_atlas.idx < xarr_len(ctx->glyph_atlases));
-    NVGatlas* atlas = ctx->glyph_atlases + ctx->current_atlas.idx;
+// Copies the dirty rows of an atlas page to staging images and queues them to be drawn into the page in
+// nvgEndFrame(). 'data' may be reused straight after. No dirty regions means the whole page.
+// Returns the number of bytes uploaded
+static size_t nvg__stageAtlasUpload(NVGcontext* ctx, int atlas_idx, const uint8_t* data)
+{
+    NVGatlas* atlas = ctx->glyph_atlases + atlas_idx;
 
-    int err = FT_Load_Glyph(ctx->ft_face, glyph_index, NVG_FT_LOAD);
-    xassert(!err);
+    // Regions are widened to whole rows, so each band is contiguous in 'data'
+    bool rows[NVG_ATLAS_HEIGHT];
+    memset(rows, atlas->dirty.num == 0, sizeof(rows));
+    for (int i = 0; i < atlas->dirty.num; i++)
+    {
+        int y0 = xm_maxi(atlas->dirty.rects[i].y0, 0);
+        int y1 = xm_mini(atlas->dirty.rects[i].y1, NVG_ATLAS_HEIGHT);
+        for (int y = y0; y < y1; y++)
+            rows[y] = true;
+    }
+    atlas->dirty.num = 0;
 
-    const FT_GlyphSlot glyph = ctx->ft_face->glyph;
-    const FT_Bitmap*   bmp   = &glyph->bitmap;
-    xassert(bmp->pixel_mode == NVG_FT_PIXEL_MODE);
-    xassert((bmp->width % NVG_FT_BITMAP_CHANNELS) == 0); // note: FT width is measured in bytes (subpixels)
-    // Note all glyphs have height/rows... (spaces?)
-    if (bmp->width && bmp->rows)
+    const size_t band_size = (size_t)NVG_ATLAS_UPLOAD_ROWS * NVG_ATLAS_ROW_STRIDE;
+    size_t       nbytes    = 0;
+    for (int y = 0; y < NVG_ATLAS_HEIGHT; y++)
     {
-        int        width_pixels = bmp->width / NVG_FT_BITMAP_CHANNELS;
-        stbrp_rect rect         = {.w = width_pixels + RECTPACK_PADDING, .h = bmp->rows + RECTPACK_PADDING};
-        num_packed              = stbrp_pack_rects(&ctx->current_atlas.ctx, &rect, 1);
+        if (!rows[y])
+            continue;
 
-        if (num_packed == 0) // atlas is full
+        if (ctx->atlas_upload.num_staging_used == xarr_len(ctx->atlas_upload.staging))
         {
-            atlas->full = true;
+            sg_image img = sg_make_image(&(sg_image_desc){
+                .width                = NVG_ATLAS_WIDTH,
+                .height               = NVG_ATLAS_UPLOAD_ROWS,
+                .pixel_format         = NVG_SG_PIXEL_FORMAT,
+                .usage.dynamic_update = true,
+                .label                = NVG_LABEL("nanovg.atlasStaging"),
+            });
+            xassert(img.id);
+            sg_view view = sg_make_view(&(sg_view_desc){.texture.image = img});
+            xassert(view.id);
+            xarr_push(ctx->atlas_upload.staging, img);
+            xarr_push(ctx->atlas_upload.staging_views, view);
+        }
 
-            sg_view_desc view_desc = sg_query_view_desc(atlas->img_view);
-            sg_update_image(
-                view_desc.texture.image,
-                &(sg_image_data){
-                    .mip_levels[0] = {ctx->current_atlas.img_data, NVG_ATLAS_HEIGHT * NVG_ATLAS_ROW_STRIDE}});
-            atlas->dirty = false;
+        // Bands are a fixed size. The last one is moved up to stay inside the page
+        const int band_y      = xm_mini(y, NVG_ATLAS_HEIGHT - NVG_ATLAS_UPLOAD_ROWS);
+        const int staging_idx = ctx->atlas_upload.num_staging_used++;
+        sg_update_image(
+            ctx->atlas_upload.staging[staging_idx],
+            &(sg_image_data){.mip_levels[0] = {data + (size_t)band_y * NVG_ATLAS_ROW_STRIDE, band_size}});
 
-            // Clear rectpack
-            memset(&ctx->current_atlas.ctx, 0, sizeof(ctx->current_atlas.ctx));
-            stbrp_init_target(
-                &ctx->current_atlas.ctx,
-                NVG_ATLAS_WIDTH - RECTPACK_PADDING,
-                NVG_ATLAS_HEIGHT - RECTPACK_PADDING,
-                ctx->current_atlas.nodes,
-                xarr_len(ctx->current_atlas.nodes));
+        NVGatlasCopy copy = {.atlas_idx = atlas_idx, .staging_idx = staging_idx, .y0 = band_y};
+        xarr_push(ctx->atlas_upload.copies, copy);
+        nbytes += band_size;
+        y       = band_y + NVG_ATLAS_UPLOAD_ROWS - 1;
+    }
+    return nbytes;
+}
 
-            rect       = (stbrp_rect){.w = width_pixels + RECTPACK_PADDING, .h = bmp->rows + RECTPACK_PADDING};
-            num_packed = stbrp_pack_rects(&ctx->current_atlas.ctx, &rect, 1);
-            xassert(num_packed == 1);
+// Destroys staging images past the first 'keep'
+static void nvg__trimAtlasStaging(NVGcontext* ctx, int keep)
+{
+    for (int i = keep; i < xarr_len(ctx->atlas_upload.staging); i++)
+    {
+        sg_destroy_view(ctx->atlas_upload.staging_views[i]);
+        sg_destroy_image(ctx->atlas_upload.staging[i]);
+    }
+    if (keep < xarr_len(ctx->atlas_upload.staging))
+    {
+        xarr_setlen(ctx->atlas_upload.staging, keep);
+        xarr_setlen(ctx->atlas_upload.staging_views, keep);
+    }
+}
 
-            // make new atlas
-            NVGatlas new_atlas = glyph_atlas_new();
-            xarr_push(ctx->glyph_atlases, new_atlas);
-            ctx->current_atlas.idx++;
+// Draws the bands queued by nvg__stageAtlasUpload() into their atlas pages. Must be called outside of a pass
+static void nvg__drawAtlasUploads(NVGcontext* ctx)
+{
+    // GL puts the origin of render targets at the bottom left, but either way gl_FragCoord.y is the row in memory
+    const sg_backend backend         = sg_query_backend();
+    const bool       origin_top_left = backend != SG_BACKEND_GLCORE && backend != SG_BACKEND_GLES3;
 
-            atlas = ctx->glyph_atlases + ctx->current_atlas.idx;
-        }
+    const int num_copies = xarr_len(ctx->atlas_upload.copies);
+    for (int i = 0; i < num_copies;)
+    {
+        const int atlas_idx = ctx->atlas_upload.copies[i].atlas_idx;
+        NVGatlas* atlas     = ctx->glyph_atlases + atlas_idx;
 
-        if (num_packed)
+        sg_begin_pass(&(sg_pass){
+            .action.colors[0]      = {.load_action = atlas->needs_clear ? SG_LOADACTION_CLEAR : SG_LOADACTION_LOAD},
+            .attachments.colors[0] = atlas->att_view,
+            .label                 = NVG_LABEL("nanovg.atlasUpload"),
+        });
+        atlas->needs_clear = false;
+        sg_apply_pipeline(ctx->atlas_upload.pip);
+
+        for (; i < num_copies && ctx->atlas_upload.copies[i].atlas_idx == atlas_idx; i++)
         {
-            int expected_height = glyph->metrics.height >> 6;
-            xassert(expected_height == bmp->rows);
-            NVGatlasRect arect;
-            arect.header.glyph_index = glyph_index;
-            arect.header.font_size   = font_size;
-            arect.bearing_x          = glyph->bitmap_left;
-            arect.bearing_y          = glyph->bitmap_top;
-            arect.x                  = rect.x + RECTPACK_PADDING;
-            arect.y                  = rect.y + RECTPACK_PADDING;
-            arect.w                  = width_pixels;
-            arect.h                  = bmp->rows;
-            arect.img_view           = atlas->img_view;
-            xassert(glyph->advance.x < (1 << 15));
-            xassert(glyph->advance.y < (1 << 15));
-            arect.advance_x = glyph->advance.x;
-            arect.advance_y = glyph->advance.y;
-            xassert(arect.x + arect.w < NVG_ATLAS_WIDTH);
-            xassert(arect.y + arect.h < NVG_ATLAS_HEIGHT);
+            const NVGatlasCopy* copy = ctx->atlas_upload.copies + i;
+            sg_apply_viewport(0, copy->y0, NVG_ATLAS_WIDTH, NVG_ATLAS_UPLOAD_ROWS, origin_top_left);
+            sg_apply_bindings(&(sg_bindings){
+                .views[VIEW_tex]   = ctx->atlas_upload.staging_views[copy->staging_idx],
+                .samplers[SMP_smp] = ctx->sampler_nearest,
+            });
+            fs_atlas_copy_t uniforms = {.u_y0 = (float)copy->y0};
+            sg_apply_uniforms(UB_fs_atlas_copy, &SG_RANGE(uniforms));
+            sg_draw(0, 3, 1);
+        }
+        sg_end_pass();
+    }
+    xarr_setlen(ctx->atlas_upload.copies, 0);
+}
 
-            xarr_push(ctx->rects, arect);
+enum
+{
+    // NVGatlasRect.atlas_idx for glyphs without a bitmap, or glyphs only measured & not yet rastered
+    NVG_GLYPH_NO_ATLAS = 0xff,
+    // NVGatlasRect.atlas_idx for glyphs queued for the background rasterizer
+    NVG_GLYPH_PENDING = 0xfe,
+};
 
-            for (int y = 0; y < bmp->rows; y++)
+// The pixel size a glyph drawn at 'font_size' is rastered at. SDF glyphs are rastered once & scaled
+static float nvg__glyphRasterSize(float font_size)
+{
+#ifdef NVG_FONT_FREETYPE_SDF
+    return NVG_SDF_GLYPH_SIZE;
+#else
+    return font_size;
+#endif
+}
+
+static NVGatlasRectHeader nvg__glyphHeader(NVGcontext* ctx, uint32_t glyph_index, float font_size)
+{
+    font_size                 = nvg__glyphRasterSize(font_size);
+    const int font_size_fixed = (int)(font_size * (1 << NVG_GLYPH_FONT_SIZE_SHIFT) + 0.5f);
+    xassert(font_size_fixed > 0 && font_size_fixed <= UINT16_MAX);
+    xassert(ctx->state.fontId >= 0 && ctx->state.fontId <= UINT8_MAX);
+
+    NVGatlasRectHeader header = {
+        .glyph_index    = glyph_index,
+        .font_size      = font_size_fixed,
+        .font_id        = ctx->state.fontId,
+        .subpixel_phase = ctx->glyph_phase,
+    };
+    return header;
+}
+
+// murmur3 64bit finaliser
+static uint32_t nvg__hashGlyphHeader(uint64_t key)
+{
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdull;
+    key ^= key >> 33;
+    key *= 0xc4ceb9fe1a85ec53ull;
+    key ^= key >> 33;
+    return (uint32_t)key;
+}
+
+static void nvg__glyphIndexInsert(NVGcontext* ctx, uint32_t rect_idx)
+{
+    const uint32_t mask = ctx->rects_index_cap - 1;
+    uint32_t       slot = nvg__hashGlyphHeader(ctx->rects[rect_idx].header.data) & mask;
+    while (ctx->rects_index[slot] != 0)
+        slot = (slot + 1) & mask;
+    ctx->rects_index[slot] = rect_idx + 1;
+}
+
+// Rebuilds the index from scratch. Used when growing, and whenever rects are moved around
+static void nvg__glyphIndexRebuild(NVGcontext* ctx, uint32_t cap)
+{
+    xassert((cap & (cap - 1)) == 0);
+    if (cap != ctx->rects_index_cap)
+    {
+        NVG_FREE(ctx->rects_index);
+        ctx->rects_index     = NVG_MALLOC(sizeof(*ctx->rects_index) * cap);
+        ctx->rects_index_cap = cap;
+    }
+    memset(ctx->rects_index, 0, sizeof(*ctx->rects_index) * cap);
+
+    const int num_rects = xarr_len(ctx->rects);
+    for (int i = 0; i < num_rects; i++)
+        nvg__glyphIndexInsert(ctx, i);
+}
+
+// Returns index into ctx->rects, or -1 if not found
+static int nvg__glyphIndexFind(NVGcontext* ctx, NVGatlasRectHeader header)
+{
+    const uint32_t mask = ctx->rects_index_cap - 1;
+    uint32_t       slot = nvg__hashGlyphHeader(header.data) & mask;
+    // Load factor is kept <= 0.5, so an empty slot is always found
+    while (ctx->rects_index[slot] != 0)
+    {
+        uint32_t rect_idx = ctx->rects_index[slot] - 1;
+        if (ctx->rects[rect_idx].header.data == header.data)
+            return rect_idx;
+        slot = (slot + 1) & mask;
+    }
+    return -1;
+}
+
+static void nvg__evictGlyphAtlas(NVGcontext* ctx, int atlas_idx)
+{
+    NVGatlas* atlas = ctx->glyph_atlases + atlas_idx;
+
+    // Drop all cached glyphs living on the page. Glyphs without bitmaps are kept
+    const int num_rects = xarr_len(ctx->rects);
+    int       num_kept  = 0;
+    for (int i = 0; i < num_rects; i++)
+    {
+        if (ctx->rects[i].atlas_idx != atlas_idx)
+            ctx->rects[num_kept++] = ctx->rects[i];
+        else if (ctx->rects[i].header.subpixel_phase != 0)
+            ctx->frame_stats.glyph_subpixel_variants--;
+    }
+    xarr_setlen(ctx->rects, num_kept);
+    nvg__glyphIndexRebuild(ctx, ctx->rects_index_cap);
+
+    atlas->full        = false;
+    atlas->needs_clear = true;
+    atlas->dirty.num   = 0;
+    ctx->glyph_epoch++;
+    ctx->frame_stats.glyph_atlas_evictions++;
+}
+
+// Called when the current atlas is full. Moves packing on to an empty page, either by creating a new page, or by
+// evicting the least recently used page once NVG_MAX_GLYPH_ATLASES pages are in use.
+// Returns false if every other page has been used this frame
+static bool nvg__nextGlyphAtlas(NVGcontext* ctx)
+{
+    NVGatlas* atlas = ctx->glyph_atlases + ctx->current_atlas.idx;
+    if (!atlas->full)
+    {
+        atlas->full = true;
+
+        if (atlas->dirty.num)
+            ctx->frame_stats.uploaded_bytes +=
+                nvg__stageAtlasUpload(ctx, ctx->current_atlas.idx, ctx->current_atlas.img_data);
+        // The page has an upload queued for nvgEndFrame(). Stamping the page protects it from eviction
+        atlas->last_used_frame = ctx->frame_id;
+
+        if (ctx->flags & NVG_GLYPH_CACHE_PIXELS)
+        {
+            const size_t img_size = NVG_ATLAS_HEIGHT * NVG_ATLAS_ROW_STRIDE;
+            if (!atlas->img_data)
+                atlas->img_data = NVG_MALLOC(img_size);
+            memcpy(atlas->img_data, ctx->current_atlas.img_data, img_size);
+        }
+    }
+
+    const int num_atlases = xarr_len(ctx->glyph_atlases);
+    int       next_idx    = -1;
+    if (num_atlases < NVG_MAX_GLYPH_ATLASES)
+    {
+        NVGatlas new_atlas = glyph_atlas_new();
+        xarr_push(ctx->glyph_atlases, new_atlas);
+        next_idx = num_atlases;
+    }
+    else
+    {
+        // Pages used this frame may be referenced by layouts & draw commands, so they can't be evicted
+        uint32_t oldest_frame = ctx->frame_id;
+        for (int i = 0; i < num_atlases; i++)
+        {
+            const NVGatlas* a = ctx->glyph_atlases + i;
+            if (i != ctx->current_atlas.idx && a->last_used_frame < oldest_frame)
             {
-#if defined(NVG_FONT_FREETYPE_SINGLECHANNEL)
-                unsigned char* dst = ctx->current_atlas.img_data + (arect.y + y) * NVG_ATLAS_ROW_STRIDE + arect.x;
-                unsigned char* src = bmp->buffer + y * bmp->pitch;
+                oldest_frame = a->last_used_frame;
+                next_idx     = i;
+            }
+        }
+        if (next_idx < 0)
+            return false;
 
-                unsigned char(*src_view)[512]  = (void*)src;
-                src_view                      += 0;
-                unsigned char(*dst_view)[512]  = (void*)dst;
-                dst_view                      += 0;
+        nvg__evictGlyphAtlas(ctx, next_idx);
+    }
+
+    ctx->current_atlas.idx             = next_idx;
+    ctx->frame_stats.glyph_atlas_pages = xarr_len(ctx->glyph_atlases);
 
-                memcpy(dst, src, width_pixels);
+    memset(ctx->current_atlas.img_data, 0, NVG_ATLAS_HEIGHT * NVG_ATLAS_ROW_STRIDE);
+
+    // Clear rectpack
+    memset(&ctx->current_atlas.ctx, 0, sizeof(ctx->current_atlas.ctx));
+    stbrp_init_target(
+        &ctx->current_atlas.ctx,
+        NVG_ATLAS_WIDTH - RECTPACK_PADDING,
+        NVG_ATLAS_HEIGHT - RECTPACK_PADDING,
+        ctx->current_atlas.nodes,
+        xarr_len(ctx->current_atlas.nodes));
+    return true;
+}
 
-                dst_view += 0;
+#ifdef NVG_FONT_FREETYPE
+// A rastered glyph waiting to be packed into an atlas
+typedef struct NVGglyphBitmap
+{
+    NVGatlasRect rect;          // Metrics from the rendered bitmap. Atlas fields are unset
+    size_t       pixels_offset; // Offset into a staging buffer. Bitmap rows are tightly packed, in FreeType's format
+} NVGglyphBitmap;
+
+// Copies a FreeType bitmap into the current atlas at x, y
+static void nvg__blitGlyphBitmap(
+    NVGcontext*          ctx,
+    int                  x,
+    int                  y,
+    const unsigned char* buffer,
+    int                  pitch,
+    int                  width_pixels,
+    int                  rows)
+{
+    for (int row = 0; row < rows; row++)
+    {
+#if defined(NVG_FONT_FREETYPE_SINGLECHANNEL) || defined(NVG_FONT_FREETYPE_SDF)
+        unsigned char*       dst = ctx->current_atlas.img_data + (y + row) * NVG_ATLAS_ROW_STRIDE + x;
+        const unsigned char* src = buffer + row * pitch;
+
+        memcpy(dst, src, width_pixels);
 #else
-                unsigned char* dst = ctx->current_atlas.img_data + (arect.y + y) * NVG_ATLAS_ROW_STRIDE +
-                                     arect.x * NVG_GLYPH_ATLAS_CHANNELS;
-                unsigned char* src = bmp->buffer + y * bmp->pitch;
+        unsigned char* dst =
+            ctx->current_atlas.img_data + (y + row) * NVG_ATLAS_ROW_STRIDE + x * NVG_GLYPH_ATLAS_CHANNELS;
+        const unsigned char* src = buffer + row * pitch;
 
-                for (int x = 0; x < width_pixels; x++, dst += NVG_GLYPH_ATLAS_CHANNELS, src += NVG_FT_BITMAP_CHANNELS)
-                {
-                    dst[0] = src[0];
-                    dst[1] = src[1];
-                    dst[2] = src[2];
-                    dst[3] = 0;
-                }
+        for (int col = 0; col < width_pixels; col++, dst += NVG_GLYPH_ATLAS_CHANNELS, src += NVG_FT_BITMAP_CHANNELS)
+        {
+            dst[0] = src[0];
+            dst[1] = src[1];
+            dst[2] = src[2];
+            dst[3] = 0;
+        }
+#endif
+    }
+}
+
+// Packs a FreeType bitmap into the current atlas, and fills the atlas fields of 'arect'
+// Returns false if every atlas page is in use
+static bool nvg__packGlyphBitmap(
+    NVGcontext*          ctx,
+    const unsigned char* buffer,
+    int                  pitch,
+    int                  width_pixels,
+    int                  rows,
+    NVGatlasRect*        arect)
+{
+    xassert(width_pixels > 0 && rows > 0);
+    xassert(ctx->current_atlas.idx < xarr_len(ctx->glyph_atlases));
+    NVGatlas* atlas = ctx->glyph_atlases + ctx->current_atlas.idx;
+
+    stbrp_rect rect       = {.w = width_pixels + RECTPACK_PADDING, .h = rows + RECTPACK_PADDING};
+    int        num_packed = stbrp_pack_rects(&ctx->current_atlas.ctx, &rect, 1);
+
+    if (num_packed == 0) // atlas is full
+    {
+        if (!nvg__nextGlyphAtlas(ctx))
+            return false;
+
+        rect       = (stbrp_rect){.w = width_pixels + RECTPACK_PADDING, .h = rows + RECTPACK_PADDING};
+        num_packed = stbrp_pack_rects(&ctx->current_atlas.ctx, &rect, 1);
+        xassert(num_packed == 1);
+
+        atlas = ctx->glyph_atlases + ctx->current_atlas.idx;
+    }
+
+    arect->x               = rect.x + RECTPACK_PADDING;
+    arect->y               = rect.y + RECTPACK_PADDING;
+    arect->w               = width_pixels;
+    arect->h               = rows;
+    arect->img_view        = atlas->img_view;
+    arect->atlas_idx       = ctx->current_atlas.idx;
+    atlas->last_used_frame = ctx->frame_id;
+    xassert(arect->x + arect->w < NVG_ATLAS_WIDTH);
+    xassert(arect->y + arect->h < NVG_ATLAS_HEIGHT);
+
+    nvg__blitGlyphBitmap(ctx, arect->x, arect->y, buffer, pitch, width_pixels, rows);
+
+    // Include the padding, so stale pixels from evicted glyphs never bleed into this glyph
+    nvg__dirtyRectsAdd(&atlas->dirty, rect.x, rect.y, rect.w, rect.h);
+    return true;
+}
+
+// Packs many rastered glyphs at once, with one stbrp_pack_rects() call per atlas page. stb_rect_pack sorts the rects by
+// height, which packs far denser than packing glyphs one at a time as they're rastered.
+// Fills the atlas fields of each glyph's rect. Glyphs that don't fit in any page keep an atlas_idx of NVG_GLYPH_NO_ATLAS
+static void nvg__packGlyphBitmaps(NVGcontext* ctx, NVGglyphBitmap* glyphs, int num_glyphs, const unsigned char* staging)
+{
+    xarr_setlen(ctx->glyph_batch.rects, num_glyphs);
+    stbrp_rect* rects     = ctx->glyph_batch.rects;
+    int         num_rects = 0;
+    for (int i = 0; i < num_glyphs; i++)
+    {
+        NVGatlasRect* r = &glyphs[i].rect;
+        r->atlas_idx    = NVG_GLYPH_NO_ATLAS;
+        if (r->w && r->h)
+            rects[num_rects++] = (stbrp_rect){.id = i, .w = r->w + RECTPACK_PADDING, .h = r->h + RECTPACK_PADDING};
+    }
+
+    bool fresh_page = false;
+    while (num_rects)
+    {
+        stbrp_pack_rects(&ctx->current_atlas.ctx, rects, num_rects);
+
+        NVGatlas* atlas        = ctx->glyph_atlases + ctx->current_atlas.idx;
+        int       num_unpacked = 0;
+        for (int i = 0; i < num_rects; i++)
+        {
+            const stbrp_rect* rect = rects + i;
+            if (!rect->was_packed)
+            {
+                rects[num_unpacked++] = *rect;
+                continue;
+            }
+
+            const NVGglyphBitmap* g = glyphs + rect->id;
+            NVGatlasRect*         r = &glyphs[rect->id].rect;
+            r->x                    = rect->x + RECTPACK_PADDING;
+            r->y                    = rect->y + RECTPACK_PADDING;
+            r->img_view             = atlas->img_view;
+            r->atlas_idx            = ctx->current_atlas.idx;
+            xassert(r->x + r->w < NVG_ATLAS_WIDTH);
+            xassert(r->y + r->h < NVG_ATLAS_HEIGHT);
+
+            const int pitch = r->w * NVG_FT_BITMAP_CHANNELS;
+            nvg__blitGlyphBitmap(ctx, r->x, r->y, staging + g->pixels_offset, pitch, r->w, r->h);
+            nvg__dirtyRectsAdd(&atlas->dirty, rect->x, rect->y, rect->w, rect->h);
+        }
+        if (num_unpacked < num_rects)
+            atlas->last_used_frame = ctx->frame_id;
+
+        // Give up on glyphs too large for an empty page, or when every page is in use
+        if (num_unpacked == 0 || (fresh_page && num_unpacked == num_rects) || !nvg__nextGlyphAtlas(ctx))
+            break;
+        fresh_page = true;
+        num_rects  = num_unpacked;
+    }
+}
+
+// Packs rastered glyphs & replaces their pending rects in ctx->rects. Returns the number of glyphs that landed
+static int nvg__landGlyphBitmaps(NVGcontext* ctx, NVGglyphBitmap* glyphs, int num_glyphs, const unsigned char* staging)
+{
+    int num_pending = 0;
+    for (int i = 0; i < num_glyphs; i++)
+    {
+        int rect_idx = nvg__glyphIndexFind(ctx, glyphs[i].rect.header);
+        if (rect_idx >= 0 && ctx->rects[rect_idx].atlas_idx == NVG_GLYPH_PENDING)
+            glyphs[num_pending++] = glyphs[i];
+    }
+
+    nvg__packGlyphBitmaps(ctx, glyphs, num_pending, staging);
+
+    int num_landed = 0;
+    for (int i = 0; i < num_pending; i++)
+    {
+        // Packing may evict a page, moving rects around
+        int rect_idx = nvg__glyphIndexFind(ctx, glyphs[i].rect.header);
+        xassert(rect_idx >= 0);
+        NVGatlasRect* r                = ctx->rects + rect_idx;
+        glyphs[i].rect.last_used_frame = r->last_used_frame;
+        // Glyphs that didn't fit are left without an atlas, and are rastered again next time they're used
+        *r = glyphs[i].rect;
+        if (r->atlas_idx != NVG_GLYPH_NO_ATLAS || r->w == 0 || r->h == 0)
+            num_landed++;
+    }
+    return num_landed;
+}
+
+_Static_assert(NVG_GLYPH_SUBPIXEL_PHASES >= 1 && NVG_GLYPH_SUBPIXEL_PHASES <= 64, "phases are 26.6 fractions");
+
+// Offsets the outlines of glyphs loaded from 'face' by a subpixel phase. Hinting is unaffected
+static void nvg__setGlyphPhaseTransform(FT_Face face, int phase)
+{
+    FT_Vector delta = {(phase * 64) / NVG_GLYPH_SUBPIXEL_PHASES, 0};
+    FT_Set_Transform(face, NULL, &delta);
+}
+
+static FT_Error nvg__initFreeType(FT_Library* lib)
+{
+    FT_Error err = FT_Init_FreeType(lib);
+#ifdef NVG_FONT_FREETYPE_SDF
+    if (!err)
+    {
+        FT_Int spread = NVG_SDF_SPREAD;
+        FT_Property_Set(*lib, "sdf", "spread", &spread);
+        FT_Property_Set(*lib, "bsdf", "spread", &spread);
+    }
 #endif
+    return err;
+}
+
+// Glyphs rastered until the next nvg__flushGlyphBatch() are staged instead of packed one at a time
+static void nvg__beginGlyphBatch(NVGcontext* ctx, bool rasterize)
+{
+    xassert(!ctx->glyph_batch.active);
+    // The background rasterizer already packs its glyphs in batches
+    ctx->glyph_batch.active = rasterize && ctx->glyph_worker == NULL;
+}
+
+// Packs the glyphs staged since nvg__beginGlyphBatch(), then points the pending glyphs in 'layout' at their atlas
+static void nvg__flushGlyphBatch(NVGcontext* ctx, NVGtextLayout* layout)
+{
+    ctx->glyph_batch.active = false;
+    const int num_glyphs    = xarr_len(ctx->glyph_batch.glyphs);
+    if (num_glyphs == 0)
+        return;
+
+    nvg__landGlyphBitmaps(ctx, ctx->glyph_batch.glyphs, num_glyphs, ctx->glyph_batch.staging);
+    xarr_setlen(ctx->glyph_batch.glyphs, 0);
+    xarr_setlen(ctx->glyph_batch.staging, 0);
+
+    if (layout)
+    {
+        NVGglyphPosition2* glyphs = nvgLayoutGetGlyphs(layout);
+        for (int i = 0; i < layout->num_glyphs; i++)
+        {
+            NVGatlasRect* r = &glyphs[i].rect;
+            if (r->atlas_idx == NVG_GLYPH_PENDING)
+            {
+                int rect_idx = nvg__glyphIndexFind(ctx, r->header);
+                xassert(rect_idx >= 0);
+                *r = ctx->rects[rect_idx];
             }
+        }
+    }
+}
 
-            atlas->dirty = true;
+// Rasters a glyph to the current atlas and fills 'arect'. Glyphs without a bitmap (eg. spaces) are not packed.
+// Returns 0 if the glyph could not be packed, in which case 'arect' should not be cached
+int nvg__renderGlyph(NVGcontext* ctx, uint32_t glyph_index, float font_size, NVGatlasRect* arect)
+{
+    nvg__setGlyphPhaseTransform(ctx->ft_face, ctx->glyph_phase);
+#ifdef NVG_FONT_FREETYPE_SDF
+    nvg__setFontPixelSize(ctx, NVG_SDF_GLYPH_SIZE);
+    int err = FT_Load_Glyph(ctx->ft_face, glyph_index, NVG_FT_LOAD);
+    // Layouts keep using the drawn size for kerning
+    nvg__setFontPixelSize(ctx, font_size);
+#else
+    int err = FT_Load_Glyph(ctx->ft_face, glyph_index, NVG_FT_LOAD);
+#endif
+    xassert(!err);
+
+    const FT_GlyphSlot glyph = ctx->ft_face->glyph;
+    const FT_Bitmap*   bmp   = &glyph->bitmap;
+    xassert(bmp->pixel_mode == NVG_FT_PIXEL_MODE);
+    xassert((bmp->width % NVG_FT_BITMAP_CHANNELS) == 0); // note: FT width is measured in bytes (subpixels)
+    xassert(glyph->advance.x < (1 << 15));
+    xassert(glyph->advance.y < (1 << 15));
+
+    memset(arect, 0, sizeof(*arect));
+    arect->header          = nvg__glyphHeader(ctx, glyph_index, font_size);
+    arect->advance_x       = glyph->advance.x;
+    arect->advance_y       = glyph->advance.y;
+    arect->atlas_idx       = NVG_GLYPH_NO_ATLAS;
+    arect->last_used_frame = ctx->frame_id;
+
+    // Note all glyphs have height/rows... (spaces?)
+    if (bmp->width && bmp->rows)
+    {
+        int expected_height = glyph->metrics.height >> 6;
+        xassert(expected_height == bmp->rows);
+        arect->bearing_x = glyph->bitmap_left;
+        arect->bearing_y = glyph->bitmap_top;
+
+        int width_pixels = bmp->width / NVG_FT_BITMAP_CHANNELS;
+        if (ctx->glyph_batch.active)
+        {
+            // Packed along with the rest of the layout's glyphs in nvg__flushGlyphBatch()
+            arect->w         = width_pixels;
+            arect->h         = bmp->rows;
+            arect->atlas_idx = NVG_GLYPH_PENDING;
+
+            NVGglyphBitmap g = {.rect = *arect, .pixels_offset = xarr_len(ctx->glyph_batch.staging)};
+            xarr_setlen(ctx->glyph_batch.staging, g.pixels_offset + bmp->width * bmp->rows);
+            unsigned char* dst = ctx->glyph_batch.staging + g.pixels_offset;
+            for (int y = 0; y < bmp->rows; y++)
+                memcpy(dst + y * bmp->width, bmp->buffer + y * bmp->pitch, bmp->width);
+            xarr_push(ctx->glyph_batch.glyphs, g);
+        }
+        else if (!nvg__packGlyphBitmap(ctx, bmp->buffer, bmp->pitch, width_pixels, bmp->rows, arect))
+        {
+            return 0;
         }
     }
 
-    return num_packed;
+    return 1;
+}
+
+// Fills 'arect' with glyph metrics without rendering a bitmap or touching the atlas.
+// Bitmap extents are estimated from the hinted outline, and may differ slightly from the rendered bitmap
+int nvg__loadGlyphMetrics(NVGcontext* ctx, uint32_t glyph_index, float font_size, NVGatlasRect* arect)
+{
+#ifdef NVG_FONT_FREETYPE_SDF
+    nvg__setFontPixelSize(ctx, NVG_SDF_GLYPH_SIZE);
+    int err = FT_Load_Glyph(ctx->ft_face, glyph_index, NVG_FT_LOAD & ~FT_LOAD_RENDER);
+    nvg__setFontPixelSize(ctx, font_size);
+#else
+    int err = FT_Load_Glyph(ctx->ft_face, glyph_index, NVG_FT_LOAD & ~FT_LOAD_RENDER);
+#endif
+    xassert(!err);
+    if (err)
+        return 0;
+
+    const FT_GlyphSlot      glyph = ctx->ft_face->glyph;
+    const FT_Glyph_Metrics* m     = &glyph->metrics;
+    xassert(glyph->advance.x < (1 << 15));
+    xassert(glyph->advance.y < (1 << 15));
+
+    // Metrics ignore FT_Set_Transform(), so apply the subpixel phase here
+    const int phase_x = (ctx->glyph_phase * 64) / NVG_GLYPH_SUBPIXEL_PHASES;
+
+    // Round outwards to the pixel grid, the same as FreeType does when rendering
+    int left   = (m->horiBearingX + phase_x) >> 6;
+    int right  = (m->horiBearingX + phase_x + m->width + 63) >> 6;
+    int top    = (m->horiBearingY + 63) >> 6;
+    int bottom = (m->horiBearingY - m->height) >> 6;
+#ifdef NVG_FONT_FREETYPE_SDF
+    // The distance field extends past the outline
+    left   -= NVG_SDF_SPREAD;
+    right  += NVG_SDF_SPREAD;
+    top    += NVG_SDF_SPREAD;
+    bottom -= NVG_SDF_SPREAD;
+#endif
+    xassert(right - left <= UINT8_MAX);
+    xassert(top - bottom <= UINT8_MAX);
+
+    memset(arect, 0, sizeof(*arect));
+    arect->header          = nvg__glyphHeader(ctx, glyph_index, font_size);
+    arect->advance_x       = glyph->advance.x;
+    arect->advance_y       = glyph->advance.y;
+    arect->atlas_idx       = NVG_GLYPH_NO_ATLAS;
+    arect->last_used_frame = ctx->frame_id;
+    if (m->width && m->height)
+    {
+        arect->bearing_x = left;
+        arect->bearing_y = top;
+        arect->w         = right - left;
+        arect->h         = top - bottom;
+    }
+    return 1;
+}
+
+// Rasters glyphs on a background thread into a staging buffer. The UI thread packs the results into atlases during
+// nvgBeginFrame()
+// FreeType faces are not thread safe, so the worker uses its own library & faces, created from the same font data
+typedef struct NVGglyphWorker
+{
+    nvg_thread_t thread;
+    nvg_mutex_t  mutex;
+    nvg_cond_t   cond;
+    bool         quit;
+
+    // Protected by mutex
+    NVGatlasRectHeader* jobs; // xarr
+    int                 jobs_head;
+    NVGglyphBitmap*     results; // xarr
+    unsigned char*      staging; // xarr
+
+    // Owned by the UI thread. Swapped with results & staging when draining
+    NVGglyphBitmap* drain_results; // xarr
+    unsigned char*  drain_staging; // xarr
+
+    // Owned by the worker thread
+    const NVGfontSlot*  fonts;
+    struct FT_LibraryRec_* ft_lib;
+    struct FT_FaceRec_*    ft_faces[NVG_MAX_FONT_SLOTS];
+} NVGglyphWorker;
+
+static void nvg__glyphWorkerRender(NVGglyphWorker* worker, NVGatlasRectHeader header)
+{
+    const int font_idx = header.font_id - 1;
+    xassert(font_idx >= 0 && font_idx < NVG_MAX_FONT_SLOTS);
+    if (worker->ft_faces[font_idx] == NULL)
+    {
+        const NVGfontSlot* sl  = worker->fonts + font_idx;
+        int                err = FT_New_Memory_Face(
+            worker->ft_lib,
+            sl->data,
+            sl->data_size,
+            sl->face_index,
+            &worker->ft_faces[font_idx]);
+        xassert(!err);
+        if (err)
+            return;
+    }
+    FT_Face face = worker->ft_faces[font_idx];
+
+    // Matches the truncation of FT_Set_Pixel_Sizes() calls on the UI thread
+    float font_size = (float)header.font_size / (1 << NVG_GLYPH_FONT_SIZE_SHIFT);
+    FT_Set_Pixel_Sizes(face, 0, font_size);
+    nvg__setGlyphPhaseTransform(face, header.subpixel_phase);
+    int err = FT_Load_Glyph(face, header.glyph_index, NVG_FT_LOAD);
+    xassert(!err);
+    if (err)
+        return;
+
+    const FT_GlyphSlot glyph = face->glyph;
+    const FT_Bitmap*   bmp   = &glyph->bitmap;
+    xassert(bmp->pixel_mode == NVG_FT_PIXEL_MODE);
+
+    NVGglyphBitmap res      = {0};
+    res.rect.header         = header;
+    res.rect.advance_x      = glyph->advance.x;
+    res.rect.advance_y      = glyph->advance.y;
+    res.rect.bearing_x      = glyph->bitmap_left;
+    res.rect.bearing_y      = glyph->bitmap_top;
+    res.rect.w              = bmp->width / NVG_FT_BITMAP_CHANNELS;
+    res.rect.h              = bmp->rows;
+    res.rect.atlas_idx      = NVG_GLYPH_NO_ATLAS;
+    const size_t row_nbytes = bmp->width;
+
+    nvg_mutex_lock(&worker->mutex);
+    res.pixels_offset = xarr_len(worker->staging);
+    xarr_setlen(worker->staging, res.pixels_offset + row_nbytes * bmp->rows);
+    for (int y = 0; y < bmp->rows; y++)
+        memcpy(worker->staging + res.pixels_offset + y * row_nbytes, bmp->buffer + y * bmp->pitch, row_nbytes);
+    xarr_push(worker->results, res);
+    nvg_mutex_unlock(&worker->mutex);
+}
+
+NVG_THREAD_PROC(nvg__glyphWorkerProc, arg)
+{
+    NVGglyphWorker* worker = arg;
+    while (true)
+    {
+        nvg_mutex_lock(&worker->mutex);
+        while (!worker->quit && worker->jobs_head == xarr_len(worker->jobs))
+            nvg_cond_wait(&worker->cond, &worker->mutex);
+        if (worker->quit)
+        {
+            nvg_mutex_unlock(&worker->mutex);
+            break;
+        }
+        NVGatlasRectHeader header = worker->jobs[worker->jobs_head++];
+        if (worker->jobs_head == xarr_len(worker->jobs))
+        {
+            worker->jobs_head = 0;
+            xarr_setlen(worker->jobs, 0);
+        }
+        nvg_mutex_unlock(&worker->mutex);
+
+        nvg__glyphWorkerRender(worker, header);
+    }
+    NVG_THREAD_RETURN;
+}
+
+static NVGglyphWorker* nvg__glyphWorkerCreate(NVGcontext* ctx)
+{
+    NVGglyphWorker* worker = NVG_MALLOC(sizeof(*worker));
+    memset(worker, 0, sizeof(*worker));
+    worker->fonts = ctx->fonts;
+
+    int err = nvg__initFreeType(&worker->ft_lib);
+    xassert(!err);
+    nvg_mutex_init(&worker->mutex);
+    nvg_cond_init(&worker->cond);
+    if (err || !nvg_thread_create(&worker->thread, nvg__glyphWorkerProc, worker))
+    {
+        NVG_ASSERT(false);
+        nvg_cond_destroy(&worker->cond);
+        nvg_mutex_destroy(&worker->mutex);
+        if (!err)
+            FT_Done_FreeType(worker->ft_lib);
+        NVG_FREE(worker);
+        return NULL;
+    }
+    return worker;
+}
+
+static void nvg__glyphWorkerDestroy(NVGglyphWorker* worker)
+{
+    nvg_mutex_lock(&worker->mutex);
+    worker->quit = true;
+    nvg_cond_signal(&worker->cond);
+    nvg_mutex_unlock(&worker->mutex);
+    nvg_thread_join(worker->thread);
+
+    nvg_cond_destroy(&worker->cond);
+    nvg_mutex_destroy(&worker->mutex);
+    for (int i = 0; i < NVG_ARRLEN(worker->ft_faces); i++)
+        if (worker->ft_faces[i])
+            FT_Done_Face(worker->ft_faces[i]);
+    FT_Done_FreeType(worker->ft_lib);
+
+    xarr_free(worker->jobs);
+    xarr_free(worker->results);
+    xarr_free(worker->staging);
+    xarr_free(worker->drain_results);
+    xarr_free(worker->drain_staging);
+    NVG_FREE(worker);
+}
+
+static void nvg__glyphWorkerPush(NVGcontext* ctx, NVGatlasRectHeader header)
+{
+    NVGglyphWorker* worker = ctx->glyph_worker;
+    nvg_mutex_lock(&worker->mutex);
+    xarr_push(worker->jobs, header);
+    nvg_cond_signal(&worker->cond);
+    nvg_mutex_unlock(&worker->mutex);
+    ctx->frame_stats.glyph_async_queued++;
+}
+
+// Packs glyphs rastered by the worker into atlases
+static void nvg__glyphWorkerDrain(NVGcontext* ctx)
+{
+    NVGglyphWorker* worker = ctx->glyph_worker;
+
+    nvg_mutex_lock(&worker->mutex);
+    NVGglyphBitmap* results = worker->results;
+    unsigned char*  staging = worker->staging;
+    worker->results         = worker->drain_results;
+    worker->staging         = worker->drain_staging;
+    nvg_mutex_unlock(&worker->mutex);
+
+    const int num_landed = nvg__landGlyphBitmaps(ctx, results, xarr_len(results), staging);
+    if (num_landed)
+    {
+        // Layouts cached while these glyphs were pending need rebuilding
+        ctx->glyph_land_epoch++;
+        ctx->frame_stats.glyph_async_landed += num_landed;
+    }
+
+    xarr_setlen(results, 0);
+    xarr_setlen(staging, 0);
+    worker->drain_results = results;
+    worker->drain_staging = staging;
 }
 #endif // NVG_FONT_FREETYPE
 #ifdef NVG_FONT_STB_TRUETYPE
-int nvg__renderGlyph(TextLayer* ctx, uint32_t glyph_index, float font_size)
+int nvg__renderGlyph(NVGcontext* ctx, uint32_t glyph_index, float font_size, NVGatlasRect* arect)
 {
     xassert(false); // TODO
     return 0;
@@ -2908,11 +4153,9 @@ int nvg__renderGlyph(TextLayer* ctx, uint32_t glyph_index, float font_size)
         {
             atlas->full = true;
 
-            sg_view_desc view_desc = sg_query_view_desc(atlas->img_view);
-            sg_update_image(
-                view_desc.texture.image,
-                &(sg_image_data){.mip_levels[0] = {ctx->current_atlas.img_data, NVG_ATLAS_HEIGHT *
-    NVG_ATLAS_ROW_STRIDE}}); atlas->dirty = false;
+            atlas->dirty.num                 = 0;
+            ctx->frame_stats.uploaded_bytes +=
+                nvg__stageAtlasUpload(ctx, ctx->current_atlas.idx, ctx->current_atlas.img_data);
 
             // Clear rectpack
             memset(&ctx->current_atlas.ctx, 0, sizeof(ctx->current_atlas.ctx));
@@ -2969,88 +4212,148 @@ int nvg__renderGlyph(TextLayer* ctx, uint32_t glyph_index, float font_size)
 #endif
 
 // Get cached rect. Rasters the rect to an atlas if not already cached
-// TODO: also compare font id
+// Glyphs are keyed by the current font id, glyph index & font size
+// If 'rasterize' is false, only metrics are loaded & cached, and the returned rect has a texture view id of 0
 // TODO: use fallback fonts. This may require accepting utf32 codepoints to detect language
-NVGatlasRect nvg__getGlyph(NVGcontext* ctx, uint32_t glyph_index, float font_size)
+NVGatlasRect nvg__getGlyphEx(NVGcontext* ctx, uint32_t glyph_index, float font_size, bool rasterize)
 {
-    const int num_rects = xarr_len(ctx->rects);
+    NVGatlasRectHeader header = nvg__glyphHeader(ctx, glyph_index, font_size);
 
-    NVGatlasRectHeader header = {.glyph_index = glyph_index, .font_size = font_size};
-
-    for (int j = 0; j < num_rects; j++)
+    int rect_idx = nvg__glyphIndexFind(ctx, header);
+    if (rect_idx >= 0)
     {
-        if (ctx->rects[j].header.data == header.data)
+        NVGatlasRect* lmao = ctx->rects + rect_idx;
+        // Glyphs cached by a measure only layout have metrics, but no bitmap
+        bool needs_raster = rasterize && lmao->atlas_idx == NVG_GLYPH_NO_ATLAS && lmao->w && lmao->h;
+        if (!needs_raster)
         {
-            NVGatlasRect* lmao = ctx->rects + j;
             xassert(lmao->x + lmao->w < NVG_ATLAS_WIDTH);
+            lmao->last_used_frame = ctx->frame_id;
+            if (lmao->img_view.id != 0)
+                ctx->glyph_atlases[lmao->atlas_idx].last_used_frame = ctx->frame_id;
+            ctx->frame_stats.glyph_cache_hits++;
             return *lmao;
         }
     }
+    ctx->frame_stats.glyph_cache_misses++;
 
-    int did_raster = nvg__renderGlyph(ctx, glyph_index, font_size);
-    if (did_raster)
+    NVGatlasRect arect;
+    int          ok = 0;
+#ifdef NVG_FONT_FREETYPE
+    if (rasterize && ctx->glyph_worker)
     {
-        xassert(num_rects + 1 == xarr_len(ctx->rects));
-        NVGatlasRect* lmao = ctx->rects + num_rects;
-        xassert(lmao->x + lmao->w < NVG_ATLAS_WIDTH);
-        return *lmao;
-    }
-
-    // Note: this stub has a texture view id of 0
-    // sokol_gfx should assert in debug mode when trying to bind a texture view with an id of 0
+        // Cache the metrics now so layouts are correct, and draw the glyph once the worker has rastered it
+        if (rect_idx >= 0)
+        {
+            arect = ctx->rects[rect_idx];
+            ok    = 1;
+        }
+        else
+        {
+            ok = nvg__loadGlyphMetrics(ctx, glyph_index, font_size, &arect);
+        }
+        if (ok && arect.w && arect.h)
+        {
+            arect.atlas_idx       = NVG_GLYPH_PENDING;
+            arect.last_used_frame = ctx->frame_id;
+            nvg__glyphWorkerPush(ctx, header);
+        }
+    }
+    else
+#endif
+    {
+        ok = rasterize ? nvg__renderGlyph(ctx, glyph_index, font_size, &arect)
+                       : nvg__loadGlyphMetrics(ctx, glyph_index, font_size, &arect);
+    }
+    if (ok)
+    {
+        // Rastering may evict an atlas page, moving rects around
+        rect_idx = nvg__glyphIndexFind(ctx, header);
+        if (rect_idx >= 0)
+        {
+            ctx->rects[rect_idx] = arect;
+        }
+        else
+        {
+            const int num_rects = xarr_len(ctx->rects);
+            xarr_push(ctx->rects, arect);
+            if (header.subpixel_phase != 0)
+                ctx->frame_stats.glyph_subpixel_variants++;
+            // Keep load factor <= 0.5
+            if ((uint32_t)(num_rects + 1) * 2 > ctx->rects_index_cap)
+                nvg__glyphIndexRebuild(ctx, ctx->rects_index_cap * 2);
+            else
+                nvg__glyphIndexInsert(ctx, num_rects);
+        }
+        return arect;
+    }
+
+    // Note: this stub has a texture view id of 0
+    // sokol_gfx should assert in debug mode when trying to bind a texture view with an id of 0
     // In release it should skip all draws using that view. This is our desired behaviour
     static const NVGatlasRect stub_rect = {0};
     return stub_rect;
 }
 
-bool nvg__pushGlyph(NVGcontext* ctx, int pen_x, int pen_y, const NVGatlasRect* rect)
+NVGatlasRect nvg__getGlyph(NVGcontext* ctx, uint32_t glyph_index, float font_size)
+{
+    return nvg__getGlyphEx(ctx, glyph_index, font_size, true);
+}
+
+// Writes a glyph quad for the shader. 'rect' must live in an atlas
+static uint32_t nvg__packColour(NVGcolour col)
+{
+    uint32_t packed = 0;
+    for (int i = 0; i < 4; i++)
+    {
+        float c  = nvg__clampf(col.rgba[i], 0.0f, 1.0f);
+        packed  |= (uint32_t)(c * 255.0f + 0.5f) << (i * 8);
+    }
+    return packed;
+}
+
+static void nvg__writeGlyph(
+    text_buffer_t*      obj,
+    int                 pen_x,
+    int                 pen_y,
+    const NVGatlasRect* rect,
+    uint32_t            colour,
+    float               glyph_scale)
 {
-    bool should_push = ctx->text_buffer_len < NVG_ARRLEN(ctx->text_buffer);
-    // NVG_ASSERT(should_push);
-    should_push &= rect->img_view.id != 0;
+    xassert(rect->x + rect->w < NVG_ATLAS_WIDTH);
+    xassert(rect->y + rect->h < NVG_ATLAS_HEIGHT);
+
+#ifdef NVG_FONT_FREETYPE_SDF
+    int glyph_left = pen_x + (int)floorf(rect->bearing_x * glyph_scale + 0.5f);
+    int glyph_top  = pen_y - (int)floorf(rect->bearing_y * glyph_scale + 0.5f);
+#else
+    xassert(glyph_scale == 1);
+    int glyph_left = pen_x + rect->bearing_x;
+    int glyph_top  = pen_y - rect->bearing_y;
+#endif
+    xassert(glyph_left >= INT16_MIN && glyph_left <= INT16_MAX);
+    xassert(glyph_top >= INT16_MIN && glyph_top <= INT16_MAX);
+
+    // See text_buffer in text.glsl
+    obj->coord_topleft = (uint32_t)(glyph_left + 32768) | ((uint32_t)(glyph_top + 32768) << 16);
+    obj->atlas_rect    = rect->x | (rect->y << 8) | (rect->w << 16) | ((uint32_t)rect->h << 24);
+    obj->colour        = colour;
+}
+
+bool nvg__pushGlyph(NVGcontext* ctx, int pen_x, int pen_y, const NVGatlasRect* rect, float glyph_scale)
+{
+    bool should_push = rect->img_view.id != 0;
     if (should_push)
     {
-        uint32_t tex_l = rect->x;
-        uint32_t tex_t = rect->y;
-        uint32_t tex_r = rect->x + rect->w;
-        uint32_t tex_b = rect->y + rect->h;
-
-        xassert(tex_l >= 0 && tex_l < NVG_ATLAS_WIDTH);
-        xassert(tex_t >= 0 && tex_t < NVG_ATLAS_HEIGHT);
-        xassert(tex_r >= 0 && tex_r < NVG_ATLAS_WIDTH);
-        xassert(tex_b >= 0 && tex_b < NVG_ATLAS_HEIGHT);
-
-        // atlas coordinates to UINT16 normalised texture coordinates
-        tex_l <<= NVG_ATLAS_UINT16_SHIFT;
-        tex_t <<= NVG_ATLAS_UINT16_SHIFT;
-        tex_r <<= NVG_ATLAS_UINT16_SHIFT;
-        tex_b <<= NVG_ATLAS_UINT16_SHIFT;
-        xassert(tex_l < (1 << 16));
-        xassert(tex_t < (1 << 16));
-        xassert(tex_r < (1 << 16));
-        xassert(tex_b < (1 << 16));
-
-        float glyph_left   = pen_x + (float)rect->bearing_x;
-        float glyph_top    = pen_y - (float)rect->bearing_y;
-        float glyph_right  = glyph_left + (float)rect->w;
-        float glyph_bottom = glyph_top + (float)rect->h;
-
-        xassert(glyph_left < (1 << 16));
-        xassert(glyph_top < (1 << 16));
-        xassert(glyph_right < (1 << 16));
-        xassert(glyph_bottom < (1 << 16));
-
-        text_buffer_t* obj        = ctx->text_buffer + ctx->text_buffer_len;
-        obj->coord_topleft[0]     = glyph_left;
-        obj->coord_topleft[1]     = glyph_top;
-        obj->coord_bottomright[0] = glyph_right;
-        obj->coord_bottomright[1] = glyph_bottom;
-        obj->tex_topleft          = tex_l | (tex_t << 16);
-        obj->tex_bottomright      = tex_r | (tex_b << 16);
-        // obj->tex_topleft     = tex_t | (tex_l << 16);
-        // obj->tex_bottomright = tex_b | (tex_r << 16);
-
-        ctx->text_buffer_len++;
+        const size_t len = xarr_len(ctx->text_buffer);
+        xarr_setlen(ctx->text_buffer, len + 1);
+        nvg__writeGlyph(
+            ctx->text_buffer + len,
+            pen_x,
+            pen_y,
+            rect,
+            nvg__packColour(ctx->state.paint.innerColour),
+            glyph_scale);
     }
     return should_push;
 }
@@ -3074,6 +4377,16 @@ NVGtextLayoutRow* nvg_startRow(NVGcontext* ctx, NVGtextLayout* layout)
     return rows;
 }
 
+// Converts a glyph metric from raster pixels to layout pixels. See NVGtextLayout.glyph_scale
+static int nvg__layoutPx(const NVGtextLayout* layout, int v)
+{
+#ifdef NVG_FONT_FREETYPE_SDF
+    return (int)floorf(v * layout->glyph_scale + 0.5f);
+#else
+    return v;
+#endif
+}
+
 void nvg_endRow(NVGcontext* ctx, NVGtextLayout* layout, int ymin, int ymax, int cursor_y_px)
 {
     // NVG_ASSERT(layout->num_rows > 0);
@@ -3090,16 +4403,46 @@ void nvg_endRow(NVGcontext* ctx, NVGtextLayout* layout, int ymin, int ymax, int
             row->end_idx     = layout->num_glyphs;
             row->ymin        = ymin;
             row->ymax        = ymax;
-            row->xmax        = g->x + g->rect.w;
+            row->xmax        = g->x + nvg__layoutPx(layout, g->rect.w);
             row->cursor_y_px = cursor_y_px;
         }
     }
 }
 
-// TODO: make this whole object cacheable
-const NVGtextLayout*
-nvgMakeLayout(NVGcontext* ctx, const char* text_start, const char* text_end, float font_size, float breakRowWidth)
+enum NVGlayoutFlags
+{
+    // Fill rows & bounds from glyph metrics only. Glyphs are never rastered, so the layout can't be drawn
+    NVG_LAYOUT_MEASURE_ONLY = 1 << 0,
+};
+
+// Converts a 26.6 pen position to whole pixels, and sets the subpixel phase used by the next glyph lookup.
+// With NVG_SUBPIXEL_GLYPHS the position is rounded to the nearest phase, otherwise it's snapped to the pixel
+static int nvg__glyphPenX(NVGcontext* ctx, int64_t x)
 {
+    int px           = x >> 6;
+    ctx->glyph_phase = 0;
+    if (ctx->flags & NVG_SUBPIXEL_GLYPHS)
+    {
+        int phase = ((x & 63) * NVG_GLYPH_SUBPIXEL_PHASES + 32) >> 6;
+        if (phase == NVG_GLYPH_SUBPIXEL_PHASES)
+        {
+            px++;
+            phase = 0;
+        }
+        ctx->glyph_phase = phase;
+    }
+    return px;
+}
+
+static const NVGtextLayout* nvg__makeLayout(
+    NVGcontext* ctx,
+    const char* text_start,
+    const char* text_end,
+    float       font_size,
+    float       breakRowWidth,
+    int         flags)
+{
+    const bool rasterize = (flags & NVG_LAYOUT_MEASURE_ONLY) == 0;
     if (text_end == NULL)
         text_end = text_start + strlen(text_start);
     const size_t text_len = text_end - text_start;
@@ -3124,10 +4467,8 @@ nvgMakeLayout(NVGcontext* ctx, const char* text_start, const char* text_end, flo
     kbts_ShapeEnd(ctx->kbts);
 
 #if defined(NVG_FONT_FREETYPE)
-    FT_FaceRec* face = ctx->ft_face;
-    FT_Set_Pixel_Sizes(face, 0, font_size);
-
-    const FT_Size_Metrics* m = &face->size->metrics;
+    const NVGfontSize* m = nvg__setFontPixelSize(ctx, font_size);
+    nvg__beginGlyphBatch(ctx, rasterize);
 
     int64_t line_height = (double)m->height * ctx->state.lineHeight;
 
@@ -3137,6 +4478,7 @@ nvgMakeLayout(NVGcontext* ctx, const char* text_start, const char* text_end, flo
     layout->ascender    = m->ascender >> 6;
     layout->descender   = m->descender >> 6;
     layout->line_height = line_height >> 6;
+    layout->glyph_scale = font_size / nvg__glyphRasterSize(font_size);
 #endif
 #if defined(NVG_FONT_STB_TRUETYPE)
     // TODO: stbtt
@@ -3185,31 +4527,33 @@ nvgMakeLayout(NVGcontext* ctx, const char* text_start, const char* text_end, flo
                 break;
             default:
             {
-                const NVGatlasRect rect             = nvg__getGlyph(ctx, Glyph->Id, font_size);
+                int64_t GlyphX = CursorX + Glyph->OffsetX;
+                int64_t GlyphY = CursorY + Glyph->OffsetY;
+                xassert(Glyph->OffsetY == 0);
+
+                // Font units to 26.6. Also selects the glyph's subpixel phase
+                int glyph_px_x = nvg__glyphPenX(ctx, (GlyphX * x_scale) >> 16);
+
+                const NVGatlasRect rect             = nvg__getGlyphEx(ctx, Glyph->Id, font_size, rasterize);
                 bool               add_to_metadata  = layout->num_glyphs < layout->cap_glyphs;
-                add_to_metadata                    &= rect.img_view.id != 0;
+                add_to_metadata                    &= rect.w != 0 && rect.h != 0;
 
                 // TODO: handle word breaking here
 
                 if (add_to_metadata)
                 {
-                    int64_t GlyphX = CursorX + Glyph->OffsetX;
-                    int64_t GlyphY = CursorY + Glyph->OffsetY;
-                    xassert(Glyph->OffsetY == 0);
-
-                    int glyph_px_x = (GlyphX * x_scale) >> 22;
                     // int glyph_px_y = (GlyphY * y_scale) >> 22;
                     int glyph_px_y = GlyphY >> 6;
 
                     xassert(glyph_px_x >= 0);
                     xassert(glyph_px_y >= 0);
 
-                    int glyph_ymax = rect.bearing_y;
-                    int glyph_ymin = glyph_ymax - rect.h;
+                    int glyph_ymax = nvg__layoutPx(layout, rect.bearing_y);
+                    int glyph_ymin = nvg__layoutPx(layout, rect.bearing_y - rect.h);
 
                     line_ymax = xm_maxi(glyph_ymax, line_ymax);
                     line_ymin = xm_mini(glyph_ymin, line_ymin);
-                    line_xmax = xm_maxi(glyph_px_x, rect.w);
+                    line_xmax = xm_maxi(glyph_px_x, nvg__layoutPx(layout, rect.w));
 
                     glyphs[layout->num_glyphs++] = (NVGglyphPosition2){.x = glyph_px_x, .y = glyph_px_y, .rect = rect};
                 }
@@ -3222,6 +4566,7 @@ nvgMakeLayout(NVGcontext* ctx, const char* text_start, const char* text_end, flo
             CursorY += Glyph->AdvanceY;
         }
     }
+    ctx->glyph_phase  = 0;
     int end_text_px_x = (CursorX * x_scale) >> 22;
     layout_xmax       = nvg__maxi(end_text_px_x, layout_xmax);
 
@@ -3232,14 +4577,31 @@ nvgMakeLayout(NVGcontext* ctx, const char* text_start, const char* text_end, flo
     NVG_ASSERT(layout->num_glyphs);
     NVG_ASSERT(rows[0].begin_idx < rows[0].end_idx);
 
+#if defined(NVG_FONT_FREETYPE)
+    nvg__flushGlyphBatch(ctx, layout);
+#endif
+
     return layout;
 }
 
-// Lazy and fast layout
+// TODO: make this whole object cacheable
 const NVGtextLayout*
-nvgMakeLayoutFast(NVGcontext* ctx, const char* text_start, const char* text_end, float font_size, float breakRowWidth)
+nvgMakeLayout(NVGcontext* ctx, const char* text_start, const char* text_end, float font_size, float breakRowWidth)
+{
+    return nvg__makeLayout(ctx, text_start, text_end, font_size, breakRowWidth, 0);
+}
+
+// Lazy and fast layout
+static const NVGtextLayout* nvg__makeLayoutFast(
+    NVGcontext* ctx,
+    const char* text_start,
+    const char* text_end,
+    float       font_size,
+    float       breakRowWidth,
+    int         flags)
 {
     NVG_ASSERT(font_size < 128);
+    const bool rasterize = (flags & NVG_LAYOUT_MEASURE_ONLY) == 0;
     if (text_end == NULL)
         text_end = text_start + strlen(text_start);
     const size_t text_len = text_end - text_start;
@@ -3259,16 +4621,16 @@ nvgMakeLayoutFast(NVGcontext* ctx, const char* text_start, const char* text_end,
     nvgLayoutSetGlyphs(layout, glyphs);
 
 #if defined(NVG_FONT_FREETYPE)
-    FT_FaceRec* face = ctx->ft_face;
-    FT_Set_Pixel_Sizes(face, 0, font_size);
-
-    const FT_Size_Metrics* m = &face->size->metrics;
+    FT_FaceRec*        face = ctx->ft_face;
+    const NVGfontSize* m    = nvg__setFontPixelSize(ctx, font_size);
+    nvg__beginGlyphBatch(ctx, rasterize);
 
     int64_t line_height = (double)m->height * ctx->state.lineHeight;
 
     layout->ascender    = m->ascender >> 6;
     layout->descender   = m->descender >> 6;
     layout->line_height = line_height >> 6;
+    layout->glyph_scale = font_size / nvg__glyphRasterSize(font_size);
 
     xassert(ctx->space_advance);
     const int64_t space_advance = FT_MulFix(ctx->space_advance, m->x_scale) / 2;
@@ -3326,33 +4688,42 @@ nvgMakeLayoutFast(NVGcontext* ctx, const char* text_start, const char* text_end,
             unsigned glyph_idx = FT_Get_Char_Index(face, cp);
             xassert(glyph_idx != 0);
 
-            NVGatlasRect rect = nvg__getGlyph(ctx, glyph_idx, font_size);
+            FT_Vector kerning;
+            FT_Get_Kerning(face, prev_glyph_idx, glyph_idx, FT_KERNING_DEFAULT, &kerning);
+            // Also selects the glyph's subpixel phase
+            int glyph_px_x = nvg__glyphPenX(ctx, CursorX + kerning.x);
+
+            NVGatlasRect rect = nvg__getGlyphEx(ctx, glyph_idx, font_size, rasterize);
 
             bool add_to_metadata = layout->num_glyphs < layout->cap_glyphs;
 
+#ifdef NVG_FONT_FREETYPE_SDF
+            // Unhinted, so advances scale linearly with the font size
+            int64_t advance_x = rect.advance_x * layout->glyph_scale;
+#else
+            int64_t advance_x = rect.advance_x;
+#endif
             if (cp == 32) // space
             {
-                rect.w         = space_advance >> 6;
-                rect.advance_x = space_advance;
+                // Like the rest of the rect, the width is in raster pixels
+                rect.w    = (space_advance >> 6) / layout->glyph_scale;
+                advance_x = space_advance;
             }
 
             if (add_to_metadata)
             {
-                line_ymax = xm_maxi(line_ymax, rect.bearing_y);
-                line_ymin = xm_mini(line_ymin, rect.bearing_y - rect.h);
-                FT_Vector kerning;
-                FT_Get_Kerning(face, prev_glyph_idx, glyph_idx, FT_KERNING_DEFAULT, &kerning);
-                int glyph_px_x = (CursorX + kerning.x) >> 6;
+                line_ymax = xm_maxi(line_ymax, nvg__layoutPx(layout, rect.bearing_y));
+                line_ymin = xm_mini(line_ymin, nvg__layoutPx(layout, rect.bearing_y - rect.h));
                 int glyph_px_y = (CursorY + kerning.y) >> 6;
                 NVG_ASSERT(glyph_px_x >= 0);
 
-                line_xmax = nvg__maxi(line_xmax, glyph_px_x + rect.w);
+                line_xmax = nvg__maxi(line_xmax, glyph_px_x + nvg__layoutPx(layout, rect.w));
 
                 glyphs[layout->num_glyphs++] = (NVGglyphPosition2){.x = glyph_px_x, .y = glyph_px_y, .rect = rect};
             }
-            xassert(rect.advance_x > 0);
+            xassert(advance_x > 0);
 
-            CursorX        += rect.advance_x;
+            CursorX        += advance_x;
             prev_glyph_idx  = glyph_idx;
 
             if (cp == 32) // space
@@ -3386,7 +4757,7 @@ nvgMakeLayoutFast(NVGcontext* ctx, const char* text_start, const char* text_end,
 
                     end_idx           = prev_row->end_idx;
                     prev_row->end_idx = num_glyphs_at_last_space;
-                    prev_row->xmax    = break_glyph->x + break_glyph->rect.w;
+                    prev_row->xmax    = break_glyph->x + nvg__layoutPx(layout, break_glyph->rect.w);
 
                     xassert(prev_row->begin_idx <= prev_row->end_idx);
                     layout_xmax = nvg__maxi(layout_xmax, prev_row->xmax);
@@ -3407,9 +4778,9 @@ nvgMakeLayoutFast(NVGcontext* ctx, const char* text_start, const char* text_end,
                         xassert(gp->x >= 0);
 
                         // recalculate row stats
-                        line_ymax = xm_maxi(line_ymax, gp->rect.bearing_y);
-                        line_ymin = xm_mini(line_ymin, gp->rect.bearing_y - rect.h);
-                        line_xmax = xm_maxi(line_xmax, gp->x + gp->rect.w);
+                        line_ymax = xm_maxi(line_ymax, nvg__layoutPx(layout, gp->rect.bearing_y));
+                        line_ymin = xm_mini(line_ymin, nvg__layoutPx(layout, gp->rect.bearing_y - rect.h));
+                        line_xmax = xm_maxi(line_xmax, gp->x + nvg__layoutPx(layout, gp->rect.w));
                     }
                 }
                 layout_xmax = nvg__maxi(layout_xmax, line_xmax);
@@ -3436,6 +4807,7 @@ nvgMakeLayoutFast(NVGcontext* ctx, const char* text_start, const char* text_end,
         }
         }
     }
+    ctx->glyph_phase = 0;
     layout_xmax = nvg__maxi(layout_xmax, line_xmax);
     nvg_endRow(ctx, layout, line_ymin, line_ymax, CursorY >> 6);
     layout->xmax = layout_xmax;
@@ -3455,7 +4827,7 @@ nvgMakeLayoutFast(NVGcontext* ctx, const char* text_start, const char* text_end,
         for (int j = r->begin_idx; j < r->end_idx; j++)
         {
             const NVGglyphPosition2* g  = glyphs + j;
-            int                      gr = g->x + g->rect.w;
+            int                      gr = g->x + nvg__layoutPx(layout, g->rect.w);
             NVG_ASSERT(gr <= rows[i].xmax);
             NVG_ASSERT(gr <= break_row_x_px);
         }
@@ -3468,9 +4840,127 @@ nvgMakeLayoutFast(NVGcontext* ctx, const char* text_start, const char* text_end,
     NVG_ASSERT(layout->num_glyphs);
     NVG_ASSERT(rows[0].begin_idx < rows[0].end_idx);
 
+#if defined(NVG_FONT_FREETYPE)
+    nvg__flushGlyphBatch(ctx, layout);
+#endif
+
     return layout;
 }
 
+const NVGtextLayout*
+nvgMakeLayoutFast(NVGcontext* ctx, const char* text_start, const char* text_end, float font_size, float breakRowWidth)
+{
+    return nvg__makeLayoutFast(ctx, text_start, text_end, font_size, breakRowWidth, 0);
+}
+
+// Non ASCII codepoints the fast layout handles just as well as kbts
+static bool nvg__isSimpleCodepoint(int cp)
+{
+    if (cp == 0xad) // Soft hyphen. Invisible unless kbts breaks the line there
+        return false;
+    if (cp >= 0xa0 && cp <= 0x24f) // Latin-1 Supplement, Latin Extended A & B
+        return true;
+    if (cp >= 0x2010 && cp <= 0x2027) // Dashes, quotes, bullets, ellipsis
+        return true;
+    if (cp >= 0x2030 && cp <= 0x205e) // Per mille, primes etc.
+        return true;
+    return false;
+}
+
+// Returns true if the text is plain Latin/ASCII and has nothing kbts needs to shape, such as combining marks, scripts
+// with contextual forms or bidi controls. Control characters other than \n are rejected too, as are codepoints
+// missing from the current font. The common case of pure ASCII is checked 16 bytes at a time
+static bool nvg__isSimpleText(NVGcontext* ctx, const char* text_start, const char* text_end)
+{
+    const char* iter = text_start;
+
+    // Fonts missing some of ASCII need every character looked up
+    bool check_ascii = false;
+#if defined(NVG_FONT_FREETYPE)
+    check_ascii = ctx->state.fontId <= 0 || !ctx->fonts[ctx->state.fontId - 1].has_ascii;
+#endif
+
+#if defined(NVG_SIMD_SSE2)
+    const __m128i space   = _mm_set1_epi8(0x20);
+    const __m128i newline = _mm_set1_epi8('\n');
+    while (!check_ascii && text_end - iter >= 16)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i*)iter);
+        // Signed compare. Bytes >= 0x80 are negative, so they're caught here too
+        int below_space = _mm_movemask_epi8(_mm_cmplt_epi8(v, space));
+        int is_newline  = _mm_movemask_epi8(_mm_cmpeq_epi8(v, newline));
+        if (below_space & ~is_newline)
+            break;
+        iter += 16;
+    }
+#elif defined(NVG_SIMD_NEON)
+    const uint8x16_t space   = vdupq_n_u8(0x20);
+    const uint8x16_t newline = vdupq_n_u8('\n');
+    const uint8x16_t high    = vdupq_n_u8(0x80);
+    while (!check_ascii && text_end - iter >= 16)
+    {
+        uint8x16_t v    = vld1q_u8((const uint8_t*)iter);
+        uint8x16_t ctrl = vbicq_u8(vcltq_u8(v, space), vceqq_u8(v, newline));
+        uint8x16_t bad  = vorrq_u8(ctrl, vcgeq_u8(v, high));
+        if (vmaxvq_u8(bad))
+            break;
+        iter += 16;
+    }
+#endif
+
+    while (iter < text_end)
+    {
+        unsigned char c = *iter;
+        if (c < 0x80)
+        {
+            if (c < 0x20 && c != '\n')
+                return false;
+#if defined(NVG_FONT_FREETYPE)
+            if (check_ascii && c != '\n' && FT_Get_Char_Index(ctx->ft_face, c) == 0)
+                return false;
+#endif
+            iter++;
+        }
+        else
+        {
+            int cp = 0;
+            iter   = utf8codepoint(iter, &cp);
+            if (!nvg__isSimpleCodepoint(cp))
+                return false;
+#if defined(NVG_FONT_FREETYPE)
+            // The fast layout has no fallback for missing glyphs. kbts will use .notdef
+            if (FT_Get_Char_Index(ctx->ft_face, cp) == 0)
+                return false;
+#endif
+        }
+    }
+    return true;
+}
+
+const NVGtextLayout*
+nvgMakeLayoutAuto(NVGcontext* ctx, const char* text_start, const char* text_end, float font_size, float breakRowWidth)
+{
+    if (text_end == NULL)
+        text_end = text_start + strlen(text_start);
+
+    // nvgMakeLayoutFast() only supports font sizes < 128
+    if (font_size < 128 && nvg__isSimpleText(ctx, text_start, text_end))
+        return nvg__makeLayoutFast(ctx, text_start, text_end, font_size, breakRowWidth, 0);
+    return nvg__makeLayout(ctx, text_start, text_end, font_size, breakRowWidth, 0);
+}
+
+const NVGtextLayout*
+nvgMeasureLayout(NVGcontext* ctx, const char* text_start, const char* text_end, float font_size, float breakRowWidth)
+{
+    if (text_end == NULL)
+        text_end = text_start + strlen(text_start);
+
+    const int flags = NVG_LAYOUT_MEASURE_ONLY;
+    if (font_size < 128 && nvg__isSimpleText(ctx, text_start, text_end))
+        return nvg__makeLayoutFast(ctx, text_start, text_end, font_size, breakRowWidth, flags);
+    return nvg__makeLayout(ctx, text_start, text_end, font_size, breakRowWidth, flags);
+}
+
 static SGNVGcommand* sgnvg__allocCommand(NVGcontext* ctx, enum SGNVGcommandType type, const char* label);
 
 void snvg_command_draw_text(
@@ -3478,8 +4968,8 @@ void snvg_command_draw_text(
     const char* label,
     int         text_buf_start,
     int         text_buf_end,
-    NVGcolour   col,
-    sg_view     atlas_view)
+    sg_view     atlas_view,
+    float       glyph_scale)
 {
     SGNVGcommand*     cmd     = sgnvg__allocCommand(ctx, SGNVG_CMD_DRAW_TEXT, label);
     SGNVGcommandText* cmdText = linked_arena_alloc_clear(ctx->frame_arena, sizeof(*cmdText));
@@ -3487,12 +4977,21 @@ void snvg_command_draw_text(
 
     cmdText->text_buffer_start = text_buf_start;
     cmdText->text_buffer_end   = text_buf_end;
-    cmdText->colour_fill       = col;
     cmdText->atlas_view        = atlas_view;
+    cmdText->glyph_scale       = glyph_scale;
 
     cmd->payload.text = cmdText;
 }
 
+// Glyph positions are packed into int16s for the GPU, see nvg__writeGlyph(). Glyphs far enough away to overflow them,
+// eg. deep into a long editable layout, can't be on screen anyway
+static bool nvg__glyphInRange(int pen_x, int pen_y)
+{
+    const int margin = 4096; // Room for bearings, even scaled up SDF glyphs
+    return pen_x > INT16_MIN + margin && pen_x < INT16_MAX - margin && pen_y > INT16_MIN + margin &&
+           pen_y < INT16_MAX - margin;
+}
+
 void nvgDrawLayout(NVGcontext* ctx, const NVGtextLayout* layout, int x, int y)
 {
     x *= ctx->backingScaleFactor;
@@ -3540,91 +5039,948 @@ void nvgDrawLayout(NVGcontext* ctx, const NVGtextLayout* layout, int x, int y)
         y                         += r->ymin - r->cursor_y_px;
     }
 
-    // NVGglyphPosition2(*view_glyphs)[512] = (void*)layout->glyphs;
-    // NVG_ASSERT(layout->num_rows == 1);
-
     // Glyphs we need to render may live across several glyph atlases
-    // Here we will attempt to batch all glyph draws sharing the same atlas
-    // We may perform multiple passes over the glyph_pos buffer as we put all glyphs sharing a buffer into a batch
-    // at a time, and build a
-    size_t             glyph_pos_len = layout->num_glyphs;
-    NVGglyphPosition2* glyph_pos_1   = nvgLayoutGetGlyphs(layout);
-    NVGglyphPosition2* glyph_pos_2   = linked_arena_alloc(ctx->arena, sizeof(*glyph_pos_2) * glyph_pos_len);
+    // Bucket them by atlas page with a counting sort, writing each glyph straight into its bucket's range of the text
+    // buffer, then emit one draw per bucket
+    const NVGglyphPosition2* glyphs     = nvgLayoutGetGlyphs(layout);
+    const int                num_glyphs = layout->num_glyphs;
+
+    // Glyphs without a bitmap, or still waiting to be rastered, have no texture view and are skipped
+    int bucket_offsets[NVG_MAX_GLYPH_ATLASES + 1] = {0};
+    int num_drawable                              = 0;
+    for (int i = 0; i < num_glyphs; i++)
+    {
+        const NVGatlasRect* rect = &glyphs[i].rect;
+        if (rect->img_view.id != 0 && nvg__glyphInRange(x + glyphs[i].x, y + glyphs[i].y))
+        {
+            xassert(rect->atlas_idx < NVG_MAX_GLYPH_ATLASES);
+            bucket_offsets[rect->atlas_idx + 1]++;
+            num_drawable++;
+        }
+    }
+    if (num_drawable == 0)
+        return; // May be all spaces
+
+    const size_t text_buffer_len = xarr_len(ctx->text_buffer);
+    xarr_setlen(ctx->text_buffer, text_buffer_len + num_drawable);
 
-    int                glyphs_consumed      = 0;
-    NVGglyphPosition2* search_glyphs        = glyph_pos_1;
-    int                search_glyphs_len    = glyph_pos_len;
-    NVGglyphPosition2* remaining_glyphs     = glyph_pos_2;
-    int                remaining_glyphs_len = 0;
+    bucket_offsets[0] = text_buffer_len;
+    for (int i = 0; i < NVG_MAX_GLYPH_ATLASES; i++)
+        bucket_offsets[i + 1] += bucket_offsets[i];
 
-    int inf_loop_protection = 0;
-    while (glyphs_consumed < glyph_pos_len)
+    const uint32_t colour = nvg__packColour(ctx->state.paint.innerColour);
+    int            bucket_cursors[NVG_MAX_GLYPH_ATLASES];
+    memcpy(bucket_cursors, bucket_offsets, sizeof(bucket_cursors));
+    for (int i = 0; i < num_glyphs; i++)
     {
-        NVG_ASSERT(++inf_loop_protection < 50);
-        sg_view target_atlas_view = {0};
-        for (int i = 0; i < search_glyphs_len && target_atlas_view.id == 0; i++)
+        const NVGglyphPosition2* gpos = glyphs + i;
+        if (gpos->rect.img_view.id != 0 && nvg__glyphInRange(x + gpos->x, y + gpos->y))
         {
-            NVGglyphPosition2* gpos = &search_glyphs[i];
-            target_atlas_view       = gpos->rect.img_view;
+            const int      idx = gpos->rect.atlas_idx;
+            text_buffer_t* obj = ctx->text_buffer + bucket_cursors[idx]++;
+            nvg__writeGlyph(obj, x + gpos->x, y + gpos->y, &gpos->rect, colour, layout->glyph_scale);
         }
-        if (target_atlas_view.id == 0)
-        {
-            // Failed to find nay glyphs to render. May be all spaces
+    }
+
+    for (int i = 0; i < NVG_MAX_GLYPH_ATLASES; i++)
+    {
+        if (bucket_offsets[i] == bucket_offsets[i + 1])
+            continue;
+
+        // Layouts may be cached across frames without looking up their glyphs again.
+        // Stamp the page here so it can't be evicted while this frame is referencing it
+        NVGatlas* atlas        = ctx->glyph_atlases + i;
+        atlas->last_used_frame = ctx->frame_id;
+        snvg_command_draw_text(
+            ctx,
+            NVG_LABEL(__FUNCTION__),
+            bucket_offsets[i],
+            bucket_offsets[i + 1],
+            atlas->img_view,
+            layout->glyph_scale);
+    }
+}
+
+// Copies a layout into a single contiguous allocation, followed by a copy of its text
+static NVGtextLayout*
+nvg__copyLayout(LinkedArena* arena, const NVGtextLayout* src, const char* text, size_t text_len, const char** text_copy)
+{
+    const size_t glyphs_offset = (sizeof(*src) + 7) & ~7;
+    const size_t glyphs_size   = sizeof(NVGglyphPosition2) * src->num_glyphs;
+    const size_t rows_offset   = glyphs_offset + glyphs_size;
+    const size_t rows_size     = sizeof(NVGtextLayoutRow) * src->num_rows;
+    const size_t text_offset   = rows_offset + rows_size;
+
+    char*          block  = linked_arena_alloc(arena, text_offset + text_len + 1);
+    NVGtextLayout* layout = (NVGtextLayout*)block;
+
+    *layout            = *src;
+    layout->cap_glyphs = src->num_glyphs;
+    layout->cap_rows   = src->num_rows;
+    nvgLayoutSetGlyphs(layout, (NVGglyphPosition2*)(block + glyphs_offset));
+    nvgLayoutSetRows(layout, (NVGtextLayoutRow*)(block + rows_offset));
+    memcpy(block + glyphs_offset, nvgLayoutGetGlyphs(src), glyphs_size);
+    memcpy(block + rows_offset, nvgLayoutGetRows(src), rows_size);
+
+    memcpy(block + text_offset, text, text_len);
+    block[text_offset + text_len] = 0;
+    *text_copy                    = block + text_offset;
+
+    return layout;
+}
+
+static bool nvg__layoutCacheKeyEquals(const NVGlayoutCacheEntry* a, const NVGlayoutCacheEntry* b)
+{
+    return a->hash == b->hash && a->text_len == b->text_len && a->font_id == b->font_id &&
+           a->backing_scale == b->backing_scale && a->font_size == b->font_size && a->break_width == b->break_width &&
+           a->line_height == b->line_height && memcmp(a->text, b->text, a->text_len) == 0;
+}
+
+// Returns the slot holding the key, or the empty slot it should be inserted into
+static uint32_t nvg__layoutCacheFind(NVGcontext* ctx, const NVGlayoutCacheEntry* key)
+{
+    const uint32_t mask = ctx->layout_cache.cap - 1;
+    uint32_t       slot = (uint32_t)key->hash & mask;
+    while (ctx->layout_cache.entries[slot].layout != NULL)
+    {
+        if (nvg__layoutCacheKeyEquals(ctx->layout_cache.entries + slot, key))
             break;
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+// Rehashes all entries into a new table, dropping any that aren't from the current or previous generation
+static void nvg__layoutCacheRebuild(NVGcontext* ctx, uint32_t cap)
+{
+    NVGlayoutCacheEntry* old_entries = ctx->layout_cache.entries;
+    const uint32_t       old_cap     = ctx->layout_cache.cap;
+    const uint32_t       generation  = ctx->layout_cache.generation;
+
+    xassert((cap & (cap - 1)) == 0);
+    ctx->layout_cache.entries = NVG_MALLOC(sizeof(*old_entries) * cap);
+    ctx->layout_cache.cap     = cap;
+    ctx->layout_cache.num     = 0;
+    memset(ctx->layout_cache.entries, 0, sizeof(*old_entries) * cap);
+
+    for (uint32_t i = 0; i < old_cap; i++)
+    {
+        const NVGlayoutCacheEntry* e = old_entries + i;
+        if (e->layout != NULL && (generation - e->generation) <= 1)
+        {
+            uint32_t slot                   = nvg__layoutCacheFind(ctx, e);
+            ctx->layout_cache.entries[slot] = *e;
+            ctx->layout_cache.num++;
         }
+    }
+    NVG_FREE(old_entries);
+}
 
-        // sg_view target_atlas_view = search_glyphs[0].rect.img_view;
-        // NVG_ASSERT(target_atlas_view.id != 0);
+static void nvg__layoutCacheNextGeneration(NVGcontext* ctx)
+{
+    ctx->layout_cache.generation++;
+    ctx->layout_cache.generation_start_frame = ctx->frame_id;
 
-        size_t text_buf_begin_len = ctx->text_buffer_len;
+    // This arena holds the generation before last. Anything still in there went unused for a whole generation
+    linked_arena_clear(ctx->layout_cache.arenas[ctx->layout_cache.generation & 1]);
+    nvg__layoutCacheRebuild(ctx, ctx->layout_cache.cap);
+}
 
-        // Iterate through remainder of array, putting every glyph with matching atlas into our batch
-        for (int i = 0; i < search_glyphs_len; i++)
+// FNV-1a, with the remaining key params mixed in
+static uint64_t nvg__hashLayoutKey(const NVGlayoutCacheEntry* key)
+{
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (uint32_t i = 0; i < key->text_len; i++)
+    {
+        hash ^= (uint8_t)key->text[i];
+        hash *= 0x100000001b3ull;
+    }
+
+    union
+    {
+        float    f;
+        uint32_t u;
+    } font_size = {key->font_size}, break_width = {key->break_width}, line_height = {key->line_height};
+
+    hash ^= font_size.u | ((uint64_t)break_width.u << 32);
+    hash *= 0x100000001b3ull;
+    hash ^= line_height.u | ((uint64_t)key->font_id << 32) | ((uint64_t)key->backing_scale << 40);
+    hash *= 0x100000001b3ull;
+    return hash ^ (hash >> 32);
+}
+
+void nvgPrewarmGlyphs(NVGcontext* ctx, int font, float size, int backingScaleFactor, const char* codepoints)
+{
+#if defined(NVG_FONT_FREETYPE)
+    NVG_ASSERT(backingScaleFactor > 0);
+    const int prev_font_id = ctx->state.fontId;
+    nvgSetFontFaceById(ctx, font);
+    if (ctx->state.fontId == 0)
+    {
+        // Invalid font. The previous face is still selected
+        ctx->state.fontId = prev_font_id;
+        return;
+    }
+
+    const float font_size = size * backingScaleFactor;
+    nvg__setFontPixelSize(ctx, font_size);
+    nvg__beginGlyphBatch(ctx, true);
+
+    const char* iter = codepoints;
+    while (*iter)
+    {
+        int cp = 0;
+        iter   = utf8codepoint(iter, &cp);
+
+        unsigned glyph_idx = FT_Get_Char_Index(ctx->ft_face, cp);
+        if (glyph_idx != 0)
+            nvg__getGlyph(ctx, glyph_idx, font_size);
+    }
+    nvg__flushGlyphBatch(ctx, NULL);
+
+    if (prev_font_id != 0)
+        nvgSetFontFaceById(ctx, prev_font_id);
+#endif
+#if defined(NVG_FONT_STB_TRUETYPE)
+    xassert(false);
+#error "TODO: stbtt"
+#endif
+}
+
+enum
+{
+    NVG_GLYPH_CACHE_MAGIC   = 0x4347564e, // "NVGC"
+    NVG_GLYPH_CACHE_VERSION = 1,
+};
+
+// File layout: header, rects, then pages of NVG_ATLAS_HEIGHT * NVG_ATLAS_ROW_STRIDE bytes
+typedef struct NVGglyphCacheHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t key; // See nvg__glyphCacheKey()
+    uint32_t num_pages;
+    uint32_t num_rects;
+} NVGglyphCacheHeader;
+
+typedef struct NVGglyphCacheRect
+{
+    uint64_t header;
+    uint8_t  x, y, w, h;
+    int16_t  advance_x;
+    int16_t  advance_y;
+    int8_t   bearing_x;
+    int8_t   bearing_y;
+    uint8_t  atlas_idx;
+    uint8_t  reserved[5];
+} NVGglyphCacheRect;
+_Static_assert(sizeof(NVGglyphCacheHeader) == 24, "");
+_Static_assert(sizeof(NVGglyphCacheRect) == 24, "");
+
+static uint64_t nvg__hashBytes(uint64_t hash, const void* data, size_t size)
+{
+    const unsigned char* ptr = data;
+    for (; size >= 8; size -= 8, ptr += 8)
+    {
+        uint64_t word;
+        memcpy(&word, ptr, 8);
+        hash = (hash ^ word) * 0x100000001b3ull;
+    }
+    for (; size; size--, ptr++)
+        hash = (hash ^ *ptr) * 0x100000001b3ull;
+    return hash;
+}
+
+// A cache file is only valid for the same fonts in the same slots, rastered the same way
+static uint64_t nvg__glyphCacheKey(NVGcontext* ctx)
+{
+    const uint64_t params[] = {
+        NVG_GLYPH_CACHE_VERSION,
+        NVG_ATLAS_WIDTH,
+        NVG_ATLAS_HEIGHT,
+        NVG_GLYPH_ATLAS_CHANNELS,
+        RECTPACK_PADDING,
+        NVG_GLYPH_FONT_SIZE_SHIFT,
+        NVG_GLYPH_SUBPIXEL_PHASES,
+#ifdef NVG_FONT_FREETYPE
+        NVG_FT_LOAD,
+#endif
+#ifdef NVG_FONT_FREETYPE_SDF
+        NVG_SDF_GLYPH_SIZE,
+        NVG_SDF_SPREAD,
+#endif
+    };
+    uint64_t hash = nvg__hashBytes(0xcbf29ce484222325ull, params, sizeof(params));
+    for (int i = 0; i < NVG_ARRLEN(ctx->fonts); i++)
+    {
+        const NVGfontSlot* sl = ctx->fonts + i;
+        if (sl->kbtr_font_ptr == 0)
+            continue;
+        const uint64_t font_params[] = {i, sl->data_size, sl->face_index};
+        hash = nvg__hashBytes(hash, font_params, sizeof(font_params));
+        hash = nvg__hashBytes(hash, sl->data, sl->data_size);
+    }
+    return hash;
+}
+
+int nvgSaveGlyphCache(NVGcontext* ctx, const char* path)
+{
+    // Pages with pixels on the CPU, most recently used first. One page is left free for packing after loading
+    int       pages[NVG_MAX_GLYPH_ATLASES];
+    int       num_pages   = 0;
+    const int num_atlases = xarr_len(ctx->glyph_atlases);
+    for (int i = 0; i < num_atlases; i++)
+    {
+        // Pages other than the current page are always full
+        if (i == ctx->current_atlas.idx || ctx->glyph_atlases[i].img_data != NULL)
         {
-            NVGglyphPosition2* gpos = &search_glyphs[i];
+            int j = num_pages++;
+            for (; j > 0 && ctx->glyph_atlases[pages[j - 1]].last_used_frame < ctx->glyph_atlases[i].last_used_frame;
+                 j--)
+                pages[j] = pages[j - 1];
+            pages[j] = i;
+        }
+    }
+    num_pages = xm_mini(num_pages, NVG_MAX_GLYPH_ATLASES - 1);
 
-            bool should_push = target_atlas_view.id == gpos->rect.img_view.id;
+    uint8_t page_map[NVG_MAX_GLYPH_ATLASES];
+    memset(page_map, NVG_GLYPH_NO_ATLAS, sizeof(page_map));
+    for (int i = 0; i < num_pages; i++)
+        page_map[pages[i]] = i;
+
+    // Glyphs waiting on the background rasterizer, or living on pages we can't save, are skipped
+    const int num_rects = xarr_len(ctx->rects);
+    int       num_saved = 0;
+    for (int i = 0; i < num_rects; i++)
+    {
+        const uint8_t idx = ctx->rects[i].atlas_idx;
+        if (idx == NVG_GLYPH_NO_ATLAS || (idx < NVG_MAX_GLYPH_ATLASES && page_map[idx] != NVG_GLYPH_NO_ATLAS))
+            num_saved++;
+    }
+
+    // Write to a temporary file first, so other contexts never map a half written file
+    const size_t path_len = strlen(path);
+    char*        tmp_path = NVG_MALLOC(path_len + 5);
+    memcpy(tmp_path, path, path_len);
+    memcpy(tmp_path + path_len, ".tmp", 5);
+
+    FILE* file = fopen(tmp_path, "wb");
+    bool  ok   = file != NULL;
+    if (ok)
+    {
+        NVGglyphCacheHeader header = {
+            .magic     = NVG_GLYPH_CACHE_MAGIC,
+            .version   = NVG_GLYPH_CACHE_VERSION,
+            .key       = nvg__glyphCacheKey(ctx),
+            .num_pages = num_pages,
+            .num_rects = num_saved,
+        };
+        ok &= fwrite(&header, sizeof(header), 1, file) == 1;
 
-            if (should_push)
+        for (int i = 0; i < num_rects && ok; i++)
+        {
+            const NVGatlasRect* r   = ctx->rects + i;
+            uint8_t             idx = r->atlas_idx;
+            if (idx != NVG_GLYPH_NO_ATLAS)
             {
-                bool did_push = nvg__pushGlyph(ctx, x + gpos->x, y + gpos->y, &gpos->rect);
-                glyphs_consumed++;
+                if (idx >= NVG_MAX_GLYPH_ATLASES || page_map[idx] == NVG_GLYPH_NO_ATLAS)
+                    continue;
+                idx = page_map[idx];
             }
-            else if (gpos->rect.img_view.id == 0)
+            NVGglyphCacheRect cr = {
+                .header    = r->header.data,
+                .x         = r->x,
+                .y         = r->y,
+                .w         = r->w,
+                .h         = r->h,
+                .advance_x = r->advance_x,
+                .advance_y = r->advance_y,
+                .bearing_x = r->bearing_x,
+                .bearing_y = r->bearing_y,
+                .atlas_idx = idx,
+            };
+            ok &= fwrite(&cr, sizeof(cr), 1, file) == 1;
+        }
+
+        const size_t img_size = NVG_ATLAS_HEIGHT * NVG_ATLAS_ROW_STRIDE;
+        for (int i = 0; i < num_pages && ok; i++)
+        {
+            const unsigned char* pixels = pages[i] == ctx->current_atlas.idx ? ctx->current_atlas.img_data
+                                                                             : ctx->glyph_atlases[pages[i]].img_data;
+            ok &= fwrite(pixels, img_size, 1, file) == 1;
+        }
+
+        ok &= fclose(file) == 0;
+        ok  = ok && nvg_file_rename(tmp_path, path);
+        if (!ok)
+            remove(tmp_path);
+    }
+    NVG_FREE(tmp_path);
+    return ok;
+}
+
+int nvgLoadGlyphCache(NVGcontext* ctx, const char* path)
+{
+    // Loaded pages replace the atlas. Glyphs already cached would be lost
+    if (xarr_len(ctx->rects) != 0 || xarr_len(ctx->glyph_atlases) != 1)
+        return 0;
+
+    NVGfileMap map;
+    if (!nvg_file_map(&map, path))
+        return 0;
+
+    const size_t               img_size = NVG_ATLAS_HEIGHT * NVG_ATLAS_ROW_STRIDE;
+    const NVGglyphCacheHeader* header   = (const NVGglyphCacheHeader*)map.data;
+    const NVGglyphCacheRect*   rects    = (const NVGglyphCacheRect*)(header + 1);
+
+    bool ok = map.size >= sizeof(*header);
+    ok      = ok && header->magic == NVG_GLYPH_CACHE_MAGIC && header->version == NVG_GLYPH_CACHE_VERSION;
+    ok      = ok && header->num_pages < NVG_MAX_GLYPH_ATLASES;
+    ok      = ok && map.size == sizeof(*header) + (size_t)header->num_rects * sizeof(*rects) +
+                               (size_t)header->num_pages * img_size;
+    ok      = ok && header->key == nvg__glyphCacheKey(ctx);
+    for (uint32_t i = 0; ok && i < header->num_rects; i++)
+    {
+        const NVGglyphCacheRect* r = rects + i;
+        if (r->atlas_idx != NVG_GLYPH_NO_ATLAS)
+            ok = r->atlas_idx < header->num_pages && r->x + r->w < NVG_ATLAS_WIDTH && r->y + r->h < NVG_ATLAS_HEIGHT;
+    }
+
+    if (ok)
+    {
+        const int      num_pages = header->num_pages;
+        const uint8_t* pixels    = (const uint8_t*)(rects + header->num_rects);
+        for (int i = 0; i < num_pages; i++, pixels += img_size)
+        {
+            if (i >= xarr_len(ctx->glyph_atlases))
             {
-                glyphs_consumed++;
+                NVGatlas new_atlas = glyph_atlas_new();
+                xarr_push(ctx->glyph_atlases, new_atlas);
             }
-            else
+            NVGatlas* atlas        = ctx->glyph_atlases + i;
+            atlas->full            = true;
+            atlas->last_used_frame = ctx->frame_id;
+
+            // Staging copies the data, so the file can be unmapped straight after
+            atlas->dirty.num                 = 0;
+            ctx->frame_stats.uploaded_bytes += nvg__stageAtlasUpload(ctx, i, pixels);
+
+            if (ctx->flags & NVG_GLYPH_CACHE_PIXELS)
             {
-                // Build temp buffer with remaining glyphs
-                remaining_glyphs[remaining_glyphs_len++] = *gpos;
+                atlas->img_data = NVG_MALLOC(img_size);
+                memcpy(atlas->img_data, pixels, img_size);
             }
         }
-        size_t text_buf_end_len = ctx->text_buffer_len;
 
-        if (text_buf_end_len != text_buf_begin_len)
+        // Pack new glyphs on a fresh page after the loaded ones
+        if (num_pages)
         {
-            snvg_command_draw_text(
-                ctx,
-                NVG_LABEL(__FUNCTION__),
-                text_buf_begin_len,
-                text_buf_end_len,
-                ctx->state.paint.innerColour,
-                target_atlas_view);
+            NVGatlas new_atlas = glyph_atlas_new();
+            xarr_push(ctx->glyph_atlases, new_atlas);
+            ctx->current_atlas.idx             = num_pages;
+            ctx->frame_stats.glyph_atlas_pages = xarr_len(ctx->glyph_atlases);
+        }
+
+        const int num_rects = header->num_rects;
+        xarr_setlen(ctx->rects, num_rects);
+        for (int i = 0; i < num_rects; i++)
+        {
+            const NVGglyphCacheRect* r = rects + i;
+            NVGatlasRect*            a = ctx->rects + i;
+            memset(a, 0, sizeof(*a));
+            a->header.data     = r->header;
+            a->x               = r->x;
+            a->y               = r->y;
+            a->w               = r->w;
+            a->h               = r->h;
+            a->advance_x       = r->advance_x;
+            a->advance_y       = r->advance_y;
+            a->bearing_x       = r->bearing_x;
+            a->bearing_y       = r->bearing_y;
+            a->atlas_idx       = r->atlas_idx;
+            a->last_used_frame = ctx->frame_id;
+            if (r->atlas_idx != NVG_GLYPH_NO_ATLAS)
+                a->img_view = ctx->glyph_atlases[r->atlas_idx].img_view;
+            if (a->header.subpixel_phase != 0)
+                ctx->frame_stats.glyph_subpixel_variants++;
+        }
+
+        // Keep load factor <= 0.5
+        uint32_t cap = ctx->rects_index_cap;
+        while ((uint32_t)num_rects * 2 > cap)
+            cap *= 2;
+        nvg__glyphIndexRebuild(ctx, cap);
+    }
+
+    nvg_file_unmap(&map);
+    return ok;
+}
+
+// True if any glyph in the layout is still queued for the background rasterizer
+static bool nvg__layoutHasPendingGlyphs(const NVGtextLayout* layout)
+{
+    const NVGglyphPosition2* glyphs = nvgLayoutGetGlyphs(layout);
+    for (int i = 0; i < layout->num_glyphs; i++)
+        if (glyphs[i].rect.atlas_idx == NVG_GLYPH_PENDING)
+            return true;
+    return false;
+}
+
+const NVGtextLayout* nvgMakeLayoutCached(
+    NVGcontext* ctx,
+    const char* text_start,
+    const char* text_end,
+    float       font_size,
+    float       breakRowWidth)
+{
+    if (text_end == NULL)
+        text_end = text_start + strlen(text_start);
+
+    NVGlayoutCacheEntry key = {
+        .text          = text_start,
+        .text_len      = text_end - text_start,
+        .font_id       = ctx->state.fontId,
+        .backing_scale = ctx->backingScaleFactor,
+        .font_size     = font_size,
+        .break_width   = breakRowWidth,
+        .line_height   = ctx->state.lineHeight,
+    };
+    key.hash = nvg__hashLayoutKey(&key);
+
+    LinkedArena* arena = ctx->layout_cache.arenas[ctx->layout_cache.generation & 1];
+
+    uint32_t             slot = nvg__layoutCacheFind(ctx, &key);
+    NVGlayoutCacheEntry* e    = ctx->layout_cache.entries + slot;
+    const bool landed = e->has_pending && e->glyph_land_epoch != ctx->glyph_land_epoch;
+    if (e->layout != NULL && e->glyph_epoch == ctx->glyph_epoch && !landed)
+    {
+        if (e->generation != ctx->layout_cache.generation)
+        {
+            e->layout     = nvg__copyLayout(arena, e->layout, e->text, e->text_len, &e->text);
+            e->generation = ctx->layout_cache.generation;
+        }
+        ctx->frame_stats.layout_cache_hits++;
+        return e->layout;
+    }
+    ctx->frame_stats.layout_cache_misses++;
+
+    if (e->layout == NULL)
+    {
+        // Keep load factor <= 0.5
+        if ((ctx->layout_cache.num + 1) * 2 > ctx->layout_cache.cap)
+        {
+            nvg__layoutCacheRebuild(ctx, ctx->layout_cache.cap * 2);
+            slot = nvg__layoutCacheFind(ctx, &key);
+            e    = ctx->layout_cache.entries + slot;
+        }
+        ctx->layout_cache.num++;
+    }
+
+    LINKED_ARENA_LEAK_DETECT_BEGIN(ctx->arena);
+    const NVGtextLayout* layout = nvgMakeLayoutAuto(ctx, text_start, text_end, font_size, breakRowWidth);
+
+    key.layout           = nvg__copyLayout(arena, layout, text_start, key.text_len, &key.text);
+    key.generation       = ctx->layout_cache.generation;
+    key.glyph_epoch      = ctx->glyph_epoch;
+    key.glyph_land_epoch = ctx->glyph_land_epoch;
+    key.has_pending      = nvg__layoutHasPendingGlyphs(layout);
+    *e                   = key;
+
+    nvgReleaseLayout(ctx, layout);
+    LINKED_ARENA_LEAK_DETECT_END(ctx->arena);
+
+    return e->layout;
+}
+
+// Grows the editable layout's block to hold at least 'num_glyphs' & 'num_rows', keeping its contents
+static void nvg__editableReserve(NVGeditableLayout* el, int num_glyphs, int num_rows)
+{
+    NVGtextLayout* prev = el->layout;
+    if (num_glyphs <= prev->cap_glyphs && num_rows <= prev->cap_rows)
+        return;
+
+    const int    cap_glyphs    = nvg__maxi(num_glyphs, prev->cap_glyphs * 2);
+    const int    cap_rows      = nvg__maxi(num_rows, prev->cap_rows * 2);
+    const size_t glyphs_offset = (sizeof(*prev) + 7) & ~7;
+    const size_t rows_offset   = glyphs_offset + sizeof(NVGglyphPosition2) * cap_glyphs;
+
+    char*          block = NVG_MALLOC(rows_offset + sizeof(NVGtextLayoutRow) * cap_rows);
+    NVGtextLayout* next  = (NVGtextLayout*)block;
+
+    *next            = *prev;
+    next->cap_glyphs = cap_glyphs;
+    next->cap_rows   = cap_rows;
+    nvgLayoutSetGlyphs(next, (NVGglyphPosition2*)(block + glyphs_offset));
+    nvgLayoutSetRows(next, (NVGtextLayoutRow*)(block + rows_offset));
+    memcpy(nvgLayoutGetGlyphs(next), nvgLayoutGetGlyphs(prev), sizeof(NVGglyphPosition2) * prev->num_glyphs);
+    memcpy(nvgLayoutGetRows(next), nvgLayoutGetRows(prev), sizeof(NVGtextLayoutRow) * prev->num_rows);
+
+    NVG_FREE(prev);
+    el->layout = next;
+}
+
+// Lays out text[text_begin, text_end) & appends it to the scratch arrays. Positions are relative to the paragraph
+static void nvg__editableLayoutParagraph(NVGcontext* ctx, NVGeditableLayout* el, int text_begin, int text_end)
+{
+    const char* start      = el->text + text_begin;
+    const char* end        = el->text + text_end;
+    const int   glyph_base = xarr_len(el->scratch_glyphs);
+
+    // Spaces & control characters (eg. \t or a stray \r) make no glyphs, and layouts need at least one
+    bool blank = true;
+    for (const char* c = start; c != end && blank; c++)
+        blank = (unsigned char)*c <= ' ' || *c == 0x7f;
+
+    NVGeditableParagraph para = {.text_begin = text_begin, .text_end = text_end};
+    if (blank)
+    {
+        // Blank lines still take up a row
+        NVGtextLayoutRow row = {.begin_idx = glyph_base, .end_idx = glyph_base};
+        para.num_rows        = 1;
+        xarr_push(el->scratch_rows, row);
+    }
+    else
+    {
+        LINKED_ARENA_LEAK_DETECT_BEGIN(ctx->arena);
+        const NVGtextLayout* l = nvgMakeLayoutAuto(ctx, start, end, el->font_size, el->break_row_width);
+        para.num_glyphs        = l->num_glyphs;
+        para.num_rows          = l->num_rows;
+        para.has_pending       = nvg__layoutHasPendingGlyphs(l);
+
+        xarr_setlen(el->scratch_glyphs, glyph_base + l->num_glyphs);
+        memcpy(el->scratch_glyphs + glyph_base, nvgLayoutGetGlyphs(l), sizeof(NVGglyphPosition2) * l->num_glyphs);
+
+        const int row_base = xarr_len(el->scratch_rows);
+        xarr_setlen(el->scratch_rows, row_base + l->num_rows);
+        const NVGtextLayoutRow* rows = nvgLayoutGetRows(l);
+        for (int i = 0; i < l->num_rows; i++)
+        {
+            NVGtextLayoutRow* r  = el->scratch_rows + row_base + i;
+            *r                   = rows[i];
+            r->begin_idx        += glyph_base;
+            r->end_idx          += glyph_base;
+        }
+
+        nvgReleaseLayout(ctx, l);
+        LINKED_ARENA_LEAK_DETECT_END(ctx->arena);
+    }
+    xarr_push(el->scratch_paragraphs, para);
+}
+
+// Brings the paragraphs from el->stale_para on up to date, then the layout's bounds. Edits leave the glyph indexes,
+// row positions & text offsets of the paragraphs after them as they were, so a run of edits only moves them once
+static void nvg__editableFixup(NVGeditableLayout* el)
+{
+    NVGtextLayout*     l         = el->layout;
+    NVGglyphPosition2* glyphs    = nvgLayoutGetGlyphs(l);
+    NVGtextLayoutRow*  rows      = nvgLayoutGetRows(l);
+    const int          num_paras = xarr_len(el->paragraphs);
+    if (el->stale_para < num_paras)
+    {
+        int glyph_base = 0, row_base = 0, text_begin = 0;
+        if (el->stale_para > 0)
+        {
+            const NVGeditableParagraph* prev = el->paragraphs + el->stale_para - 1;
+            glyph_base                       = prev->glyph_base + prev->num_glyphs;
+            row_base                         = prev->row_base + prev->num_rows;
+            text_begin                       = prev->text_end + 1;
+        }
+        for (int p = el->stale_para; p < num_paras; p++)
+        {
+            NVGeditableParagraph* para  = el->paragraphs + p;
+            const int             shift = glyph_base - para->glyph_base;
+            const bool            moved = row_base != para->row_base;
+            for (int i = row_base; i < row_base + para->num_rows && (shift != 0 || moved); i++)
+            {
+                NVGtextLayoutRow* row  = rows + i;
+                row->begin_idx        += shift;
+                row->end_idx          += shift;
+                if (moved)
+                {
+                    const int y  = (i * el->row_height) >> 6;
+                    const int dy = y - row->cursor_y_px;
+                    for (int j = row->begin_idx; j < row->end_idx; j++)
+                        glyphs[j].y += dy;
+                    row->cursor_y_px = y;
+                }
+            }
+            para->text_end   = text_begin + (para->text_end - para->text_begin);
+            para->text_begin = text_begin;
+            para->glyph_base = glyph_base;
+            para->row_base   = row_base;
+
+            glyph_base += para->num_glyphs;
+            row_base   += para->num_rows;
+            text_begin  = para->text_end + 1;
         }
+        el->stale_para = num_paras;
+    }
+
+    if (el->xmax_stale)
+    {
+        int xmax = 0;
+        for (int i = 0; i < l->num_rows; i++)
+            xmax = nvg__maxi(xmax, rows[i].xmax);
+        l->xmax        = xmax;
+        el->xmax_stale = false;
+    }
+    const NVGtextLayoutRow* last = rows + l->num_rows - 1;
+    l->total_height_tight        = rows[0].ymax - (last->ymin - last->cursor_y_px);
+}
+
+// Replaces paragraphs [p0, p1) with the scratch paragraphs. The paragraphs after them are left for
+// nvg__editableFixup(), so an edit only touches the paragraphs it replaces
+static void nvg__editableSplice(NVGeditableLayout* el, int p0, int p1, int text_delta)
+{
+    // The new paragraphs start where paragraph p0 - 1 ends, so it must be up to date
+    if (p0 > el->stale_para)
+        nvg__editableFixup(el);
+
+    int g0 = 0, r0 = 0;
+    if (p0 > 0)
+    {
+        const NVGeditableParagraph* prev = el->paragraphs + p0 - 1;
+        g0                               = prev->glyph_base + prev->num_glyphs;
+        r0                               = prev->row_base + prev->num_rows;
+    }
+    int old_glyphs = 0, old_rows = 0;
+    for (int i = p0; i < p1; i++)
+    {
+        old_glyphs += el->paragraphs[i].num_glyphs;
+        old_rows   += el->paragraphs[i].num_rows;
+    }
+    const int new_glyphs  = xarr_len(el->scratch_glyphs);
+    const int new_rows    = xarr_len(el->scratch_rows);
+    const int glyph_delta = new_glyphs - old_glyphs;
+    const int row_delta   = new_rows - old_rows;
+
+    // Only rescan every row for the widest when the widest may have been replaced
+    bool xmax_replaced = false;
+    for (int i = r0; i < r0 + old_rows && !xmax_replaced; i++)
+        xmax_replaced = nvgLayoutGetRows(el->layout)[i].xmax >= el->layout->xmax;
+
+    const int num_glyphs = el->layout->num_glyphs + glyph_delta;
+    const int num_rows   = el->layout->num_rows + row_delta;
+    nvg__editableReserve(el, num_glyphs, num_rows);
+
+    NVGtextLayout*     l      = el->layout;
+    NVGglyphPosition2* glyphs = nvgLayoutGetGlyphs(l);
+    NVGtextLayoutRow*  rows   = nvgLayoutGetRows(l);
+    memmove(
+        glyphs + g0 + new_glyphs,
+        glyphs + g0 + old_glyphs,
+        sizeof(*glyphs) * (l->num_glyphs - g0 - old_glyphs));
+    memmove(rows + r0 + new_rows, rows + r0 + old_rows, sizeof(*rows) * (l->num_rows - r0 - old_rows));
+    memcpy(glyphs + g0, el->scratch_glyphs, sizeof(*glyphs) * new_glyphs);
+    memcpy(rows + r0, el->scratch_rows, sizeof(*rows) * new_rows);
+    l->num_glyphs = num_glyphs;
+    l->num_rows   = num_rows;
+
+    const int num_paras  = xarr_len(el->paragraphs);
+    const int new_paras  = xarr_len(el->scratch_paragraphs);
+    const int para_delta = new_paras - (p1 - p0);
+    if (para_delta > 0)
+        xarr_setlen(el->paragraphs, num_paras + para_delta);
+    memmove(el->paragraphs + p1 + para_delta, el->paragraphs + p1, sizeof(*el->paragraphs) * (num_paras - p1));
+    if (para_delta < 0)
+        xarr_setlen(el->paragraphs, num_paras + para_delta);
+    memcpy(el->paragraphs + p0, el->scratch_paragraphs, sizeof(*el->paragraphs) * new_paras);
+
+    int glyph_base = g0, row_base = r0;
+    for (int i = p0; i < p0 + new_paras; i++)
+    {
+        el->paragraphs[i].glyph_base  = glyph_base;
+        el->paragraphs[i].row_base    = row_base;
+        glyph_base                   += el->paragraphs[i].num_glyphs;
+        row_base                     += el->paragraphs[i].num_rows;
+    }
+    // Paragraphs after the new ones keep their old indexes, positions & text offsets until nvg__editableFixup()
+    if (glyph_delta != 0 || row_delta != 0 || text_delta != 0)
+        el->stale_para = nvg__mini(el->stale_para + para_delta, p0 + new_paras);
+
+    // The new rows are relative to the paragraph they were laid out in
+    int new_xmax = 0;
+    for (int i = r0; i < r0 + new_rows; i++)
+    {
+        NVGtextLayoutRow* row  = rows + i;
+        row->begin_idx        += g0;
+        row->end_idx          += g0;
+
+        const int y  = (i * el->row_height) >> 6;
+        const int dy = y - row->cursor_y_px;
+        for (int j = row->begin_idx; j < row->end_idx; j++)
+            glyphs[j].y += dy;
+        row->cursor_y_px = y;
+        new_xmax         = nvg__maxi(new_xmax, row->xmax);
+    }
+
+    if (new_xmax >= l->xmax)
+        l->xmax = new_xmax;
+    else if (xmax_replaced)
+        el->xmax_stale = true;
+    l->total_height = ((num_rows - 1) * el->row_height + (el->ascender - el->descender)) >> 6;
+}
+
+// Lays out text[text_begin, text_end) again, replacing paragraphs [p0, p1). The range must start & end on paragraph
+// boundaries. 'text_delta' is how far the text after the range has moved
+static void nvg__editableRelayout(
+    NVGcontext*        ctx,
+    NVGeditableLayout* el,
+    int                p0,
+    int                p1,
+    int                text_begin,
+    int                text_end,
+    int                text_delta)
+{
+    const int   prev_font_id     = ctx->state.fontId;
+    const float prev_line_height = ctx->state.lineHeight;
+    nvgSetFontFaceById(ctx, el->font_id);
+    ctx->state.lineHeight = el->line_height;
+    el->backing_scale     = ctx->backingScaleFactor;
+
+#if defined(NVG_FONT_FREETYPE)
+    const float        font_size = el->font_size * ctx->backingScaleFactor;
+    const NVGfontSize* m         = nvg__setFontPixelSize(ctx, font_size);
+
+    el->row_height          = (double)m->height * el->line_height;
+    el->ascender            = m->ascender;
+    el->descender           = m->descender;
+    el->layout->ascender    = m->ascender >> 6;
+    el->layout->descender   = m->descender >> 6;
+    el->layout->line_height = el->row_height >> 6;
+    el->layout->glyph_scale = font_size / nvg__glyphRasterSize(font_size);
+#endif
+#if defined(NVG_FONT_STB_TRUETYPE)
+    xassert(false);
+#error "TODO: stbtt"
+#endif
+
+    xarr_setlen(el->scratch_paragraphs, 0);
+    xarr_setlen(el->scratch_glyphs, 0);
+    xarr_setlen(el->scratch_rows, 0);
+    int para_begin = text_begin;
+    for (int i = text_begin; i < text_end; i++)
+    {
+        if (el->text[i] == '\n')
+        {
+            nvg__editableLayoutParagraph(ctx, el, para_begin, i);
+            para_begin = i + 1;
+        }
+    }
+    nvg__editableLayoutParagraph(ctx, el, para_begin, text_end);
+
+    nvg__editableSplice(el, p0, p1, text_delta);
+    el->glyph_epoch = ctx->glyph_epoch;
 
-        NVG_ASSERT(glyphs_consumed <= glyph_pos_len);
-        if (glyphs_consumed < glyph_pos_len)
+    ctx->state.lineHeight = prev_line_height;
+    if (prev_font_id != 0)
+        nvgSetFontFaceById(ctx, prev_font_id);
+}
+
+NVGeditableLayout* nvgCreateEditableLayout(
+    NVGcontext* ctx,
+    const char* start,
+    const char* end,
+    float       font_size,
+    float       breakRowWidth)
+{
+    if (end == NULL)
+        end = start + strlen(start);
+
+    NVGeditableLayout* el = NVG_MALLOC(sizeof(*el));
+    memset(el, 0, sizeof(*el));
+    el->font_id         = ctx->state.fontId;
+    el->font_size       = font_size;
+    el->break_row_width = breakRowWidth;
+    el->line_height     = ctx->state.lineHeight;
+
+    el->layout = NVG_MALLOC(sizeof(*el->layout));
+    memset(el->layout, 0, sizeof(*el->layout));
+
+    xarr_setlen(el->text, end - start);
+    memcpy(el->text, start, end - start);
+
+    nvg__editableRelayout(ctx, el, 0, 0, 0, end - start, 0);
+    return el;
+}
+
+void nvgDestroyEditableLayout(NVGcontext* ctx, NVGeditableLayout* el)
+{
+    xarr_free(el->text);
+    xarr_free(el->paragraphs);
+    xarr_free(el->scratch_paragraphs);
+    xarr_free(el->scratch_glyphs);
+    xarr_free(el->scratch_rows);
+    NVG_FREE(el->layout);
+    NVG_FREE(el);
+}
+
+void nvgEditableLayoutReplace(
+    NVGcontext*        ctx,
+    NVGeditableLayout* el,
+    int                start,
+    int                end,
+    const char*        text,
+    const char*        text_end)
+{
+    if (text_end == NULL)
+        text_end = text != NULL ? text + strlen(text) : NULL;
+
+    const int len        = xarr_len(el->text);
+    const int insert_len = text_end - text;
+    const int text_delta = insert_len - (end - start);
+    NVG_ASSERT(start >= 0 && start <= end && end <= len);
+
+    // Paragraphs from stale_para on may hold old text offsets. Only bring them up to date when the edit reaches them
+    if (el->stale_para < xarr_len(el->paragraphs) && end > el->paragraphs[el->stale_para - 1].text_end)
+        nvg__editableFixup(el);
+
+    // Paragraphs touched by the edit. There is always at least one paragraph, and the last ends at the end of the text
+    int p0 = 0;
+    while (el->paragraphs[p0].text_end < start)
+        p0++;
+    int p1 = p0;
+    while (el->paragraphs[p1].text_end < end)
+        p1++;
+    p1++;
+    const int text_begin = el->paragraphs[p0].text_begin;
+    const int text_stop  = el->paragraphs[p1 - 1].text_end + text_delta;
+
+    if (text_delta > 0)
+        xarr_setlen(el->text, len + text_delta);
+    memmove(el->text + start + insert_len, el->text + end, len - end);
+    if (insert_len > 0) // 'text' is NULL for deletes
+        memcpy(el->text + start, text, insert_len);
+    if (text_delta < 0)
+        xarr_setlen(el->text, len + text_delta);
+
+    // Other paragraphs hold glyphs from before the atlases changed. Lay everything out again
+    if (el->glyph_epoch != ctx->glyph_epoch || el->backing_scale != ctx->backingScaleFactor)
+        nvg__editableRelayout(ctx, el, 0, xarr_len(el->paragraphs), 0, xarr_len(el->text), 0);
+    else
+        nvg__editableRelayout(ctx, el, p0, p1, text_begin, text_stop, text_delta);
+}
+
+const NVGtextLayout* nvgGetEditableLayout(NVGcontext* ctx, NVGeditableLayout* el)
+{
+    if (el->glyph_epoch != ctx->glyph_epoch || el->backing_scale != ctx->backingScaleFactor)
+    {
+        nvg__editableRelayout(ctx, el, 0, xarr_len(el->paragraphs), 0, xarr_len(el->text), 0);
+    }
+    else if (el->glyph_land_epoch != ctx->glyph_land_epoch)
+    {
+        // Only paragraphs still waiting on the background rasterizer need laying out again
+        nvg__editableFixup(el);
+        for (int i = 0; i < xarr_len(el->paragraphs); i++)
         {
-            NVGglyphPosition2* tmp_glyphs = search_glyphs;
-
-            search_glyphs     = remaining_glyphs;
-            search_glyphs_len = remaining_glyphs_len;
-
-            remaining_glyphs     = tmp_glyphs;
-            remaining_glyphs_len = 0;
+            const NVGeditableParagraph* para = el->paragraphs + i;
+            if (para->has_pending)
+                nvg__editableRelayout(ctx, el, i, i + 1, para->text_begin, para->text_end, 0);
         }
     }
+    el->glyph_land_epoch = ctx->glyph_land_epoch;
+    nvg__editableFixup(el);
+    return el->layout;
 }
 
 void nvgText(NVGcontext* ctx, float x, float y, const char* text_start, const char* text_end)
@@ -3636,10 +5992,8 @@ void nvgTextBox(NVGcontext* ctx, float x, float y, float breakRowWidth, const ch
 {
     LINKED_ARENA_LEAK_DETECT_BEGIN(ctx->arena);
 
-    // const NVGtextLayout* layout = nvgMakeLayout(ctx, text_start, text_end, ctx->state.fontSize, breakRowWidth);
-    const NVGtextLayout* layout = nvgMakeLayoutFast(ctx, text_start, text_end, ctx->state.fontSize, breakRowWidth);
+    const NVGtextLayout* layout = nvgMakeLayoutCached(ctx, text_start, text_end, ctx->state.fontSize, breakRowWidth);
     nvgDrawLayout(ctx, layout, x, y);
-    nvgReleaseLayout(ctx, layout);
 
     LINKED_ARENA_LEAK_DETECT_END(ctx->arena);
 }
@@ -3898,7 +6252,7 @@ void nvgTextBoxBounds(
     float*      bounds)
 {
     LINKED_ARENA_LEAK_DETECT_BEGIN(ctx->arena);
-    const NVGtextLayout* layout = nvgMakeLayout(ctx, text_start, text_end, ctx->state.fontSize, breakRowWidth);
+    const NVGtextLayout* layout = nvgMeasureLayout(ctx, text_start, text_end, ctx->state.fontSize, breakRowWidth);
 
     bounds[0] = x;
     bounds[1] = y;
@@ -3994,6 +6348,7 @@ static void sgnvg__initPipeline(
                         {
                             [ATTR_nanovg_sg_vertex].format = SG_VERTEXFORMAT_FLOAT2,
                             [ATTR_nanovg_sg_tcoord].format = SG_VERTEXFORMAT_FLOAT2,
+                            [ATTR_nanovg_sg_frag].format   = SG_VERTEXFORMAT_FLOAT,
                         },
                 },
             .stencil = *stencil,
@@ -4017,6 +6372,7 @@ static bool sgnvg__pipelineTypeIsInUse(NVGcontext* ctx, enum SGNVGpipelineType t
     case SGNVG_PIP_BASE:
     case SGNVG_PIP_FILL_STENCIL:
     case SGNVG_PIP_FILL_DRAW:
+    case SGNVG_PIP_SHAPES:
         return true;
     case SGNVG_PIP_FILL_ANTIALIAS:
         return !!(ctx->flags & NVG_ANTIALIAS);
@@ -4032,6 +6388,25 @@ static bool sgnvg__pipelineTypeIsInUse(NVGcontext* ctx, enum SGNVGpipelineType t
     return false;
 }
 
+static uint32_t sgnvg__pipelineHash(uint32_t blendNumber)
+{
+    return ((blendNumber * 2654435761u) >> 16) & (NANOVG_SG_PIPELINE_HASH_SIZE - 1);
+}
+
+static void sgnvg__rehashPipelineCache(SGNVGpipelineCache* cache)
+{
+    memset(cache->table, 0, sizeof(cache->table));
+    for (int i = 0; i < NANOVG_SG_PIPELINE_CACHE_SIZE; i++)
+    {
+        if (cache->keys[i].blend == 0) // Never used. Real blends have no zero factors
+            continue;
+        uint32_t slot = sgnvg__pipelineHash(cache->keys[i].blend);
+        while (cache->table[slot])
+            slot = (slot + 1) & (NANOVG_SG_PIPELINE_HASH_SIZE - 1);
+        cache->table[slot] = i + 1;
+    }
+}
+
 static int sgnvg__getIndexFromCache(NVGcontext* ctx, uint32_t blendNumber)
 {
     uint16_t currentUse = ctx->pipelineCache.currentUse;
@@ -4040,13 +6415,20 @@ static int sgnvg__getIndexFromCache(NVGcontext* ctx, uint32_t blendNumber)
     int maxAgeIndex = 0;
 
     // find the correct cache entry for `blend_number`
-    for (unsigned int i = 0; i < NANOVG_SG_PIPELINE_CACHE_SIZE; i++)
+    for (uint32_t slot = sgnvg__pipelineHash(blendNumber); ctx->pipelineCache.table[slot];
+         slot          = (slot + 1) & (NANOVG_SG_PIPELINE_HASH_SIZE - 1))
     {
+        int i = ctx->pipelineCache.table[slot] - 1;
         if (ctx->pipelineCache.keys[i].blend == blendNumber)
         {
             ctx->pipelineCache.keys[i].lastUse = ctx->pipelineCache.currentUse;
             return i;
         }
+    }
+
+    // not found; find the oldest entry
+    for (unsigned int i = 0; i < NANOVG_SG_PIPELINE_CACHE_SIZE; i++)
+    {
         int age = (uint16_t)(currentUse - ctx->pipelineCache.keys[i].lastUse);
         if (age > maxAge)
         {
@@ -4068,9 +6450,12 @@ static int sgnvg__getIndexFromCache(NVGcontext* ctx, uint32_t blendNumber)
             sg_uninit_pipeline(pipelines[type]);
     // mark all as inactive
     ctx->pipelineCache.pipelinesActive[maxAgeIndex] = 0;
+    sgnvg__rehashPipelineCache(&ctx->pipelineCache);
     return maxAgeIndex;
 }
 
+_Static_assert(SGNVG_PIP_NUM_ <= 8, "SGNVGpipelineCache.pipelinesActive is a uint8_t bitmask");
+
 static sg_pipeline sgnvg__getPipelineFromCache(NVGcontext* ctx, enum SGNVGpipelineType type)
 {
     NVG_ASSERT(sgnvg__pipelineTypeIsInUse(ctx, type));
@@ -4081,6 +6466,7 @@ static sg_pipeline sgnvg__getPipelineFromCache(NVGcontext* ctx, enum SGNVGpipeli
     if (!(ctx->pipelineCache.pipelinesActive[pipelineCacheIndex] & typeMask))
     {
         ctx->pipelineCache.pipelinesActive[pipelineCacheIndex] |= typeMask;
+        ctx->frame_stats.pipelines_created++;
         switch (type)
         {
         case SGNVG_PIP_BASE:
@@ -4234,6 +6620,23 @@ static sg_pipeline sgnvg__getPipelineFromCache(NVGcontext* ctx, enum SGNVGpipeli
                 SG_CULLMODE_BACK);
             break;
 
+        case SGNVG_PIP_SHAPES:
+            // Quads come from gl_VertexIndex, so there's no vertex layout or index buffer
+            sg_init_pipeline(
+                pipeline,
+                &(sg_pipeline_desc){
+                    .shader = ctx->shape_shader,
+                    .colors[0] =
+                        {
+                            .write_mask = SG_COLORMASK_RGBA,
+                            .blend      = ctx->blend,
+                        },
+                    .primitive_type = SG_PRIMITIVETYPE_TRIANGLES,
+                    .cull_mode      = SG_CULLMODE_NONE,
+                    .label          = NVG_LABEL("nanovg.shape_pipeline"),
+                });
+            break;
+
         default:
             NVG_ASSERT(0);
         }
@@ -4241,9 +6644,10 @@ static sg_pipeline sgnvg__getPipelineFromCache(NVGcontext* ctx, enum SGNVGpipeli
     return pipeline;
 }
 
+// 'fragOffset' picks which of a call's uniforms to use, 0 or 1
 static void sgnvg__preparePipelineUniforms(
     NVGcontext*            ctx,
-    SGNVGfragUniforms*     uniforms,
+    int                    fragOffset,
     sg_view                texview,
     sg_sampler             smp,
     enum SGNVGpipelineType pipelineType)
@@ -4253,10 +6657,9 @@ static void sgnvg__preparePipelineUniforms(
 
     sg_apply_pipeline(pip);
 
+    ctx->view.fragOffset[0] = fragOffset;
     sg_apply_uniforms(UB_nanovg_viewSize, &(sg_range){&ctx->view, sizeof(ctx->view)});
     ctx->frame_stats.uploaded_bytes += sizeof(ctx->view);
-    sg_apply_uniforms(UB_nanovg_frag, &(sg_range){uniforms, sizeof(*uniforms)});
-    ctx->frame_stats.uploaded_bytes += sizeof(*uniforms);
 
     // If no image is set, use empty texture
     if (texview.id == 0)
@@ -4265,10 +6668,11 @@ static void sgnvg__preparePipelineUniforms(
         smp = ctx->sampler_nearest;
 
     sg_apply_bindings(&(sg_bindings){
-        .vertex_buffers[0]        = ctx->vertBuf,
-        .index_buffer             = ctx->indexBuf,
-        .views[VIEW_nanovg_tex]   = texview,
-        .samplers[SMP_nanovg_smp] = smp,
+        .vertex_buffers[0]          = ctx->drawVertBuf,
+        .index_buffer               = ctx->drawIndexBuf,
+        .views[VIEW_nanovg_tex]     = texview,
+        .views[VIEW_nanovg_sb_frag] = ctx->drawFragView,
+        .samplers[SMP_nanovg_smp]   = smp,
     });
 }
 
@@ -4290,8 +6694,9 @@ int nvgCreateTexture(NVGcontext* ctx, enum NVGtexture type, int w, int h, int im
     tex->type   = type;
     tex->flags  = imageFlags;
 
+    // sokol_gfx doesn't allow initial data for dynamic images. Those get uploaded in nvgEndFrame()
     sg_image_data imageData = {0};
-    if (data)
+    if (data && !dynamic_update)
     {
         imageData.mip_levels[0] = (sg_range){data, w * h * nchannels};
     }
@@ -4314,7 +6719,8 @@ int nvgCreateTexture(NVGcontext* ctx, enum NVGtexture type, int w, int h, int im
     if (data != NULL)
     {
         memcpy(tex->imgData, data, w * h * nchannels);
-        tex->flags |= NVG_IMAGE_DIRTY;
+        if (dynamic_update)
+            tex->flags |= NVG_IMAGE_DIRTY;
     }
     tex->texview = sg_make_view(&(sg_view_desc){.texture = tex->img});
 
@@ -4335,27 +6741,27 @@ int nvgUpdateTexture(NVGcontext* ctx, int image, int x0, int y0, int w, int h, c
 
     if (tex->imgData)
     {
-        // this is really weird but nanogl_gl.h is doing the same
-        // somehow we always get a whole row or so? o_O
-        x0 = 0;
-        w  = tex->width;
-
+        // Like nanovg_gl.h, 'data' points to the whole image, with rows tex->width pixels wide
         size_t bytePerPixel = 1;
         if (tex->type == NVG_TEXTURE_RGBA)
             bytePerPixel = 4;
 
-        size_t               srcLineInBytes = w * bytePerPixel;
-        size_t               dstLineInBytes = tex->width * bytePerPixel;
-        const unsigned char* src            = data + y0 * srcLineInBytes;
-        unsigned char*       dst            = tex->imgData + y0 * dstLineInBytes + x0 * bytePerPixel;
+        size_t               lineInBytes = tex->width * bytePerPixel;
+        size_t               rectInBytes = w * bytePerPixel;
+        const unsigned char* src         = data + y0 * lineInBytes + x0 * bytePerPixel;
+        unsigned char*       dst         = tex->imgData + y0 * lineInBytes + x0 * bytePerPixel;
 
         for (int y = 0; y < h; y++)
         {
-            memcpy(dst, src, srcLineInBytes);
-            src += srcLineInBytes;
-            dst += dstLineInBytes;
+            memcpy(dst, src, rectInBytes);
+            src += lineInBytes;
+            dst += lineInBytes;
         }
 
+        // A pending whole image upload already covers this region
+        bool whole_image_pending = (tex->flags & NVG_IMAGE_DIRTY) && tex->dirty.num == 0;
+        if (!whole_image_pending)
+            nvg__dirtyRectsAdd(&tex->dirty, x0, y0, w, h);
         tex->flags |= NVG_IMAGE_DIRTY;
     }
 
@@ -4464,103 +6870,182 @@ static void sgnvg__fill(NVGcontext* ctx, SGNVGcall* call)
     SGNVGpath* paths = call->paths;
     int        i, npaths = call->num_paths;
 
-    sgnvg__preparePipelineUniforms(ctx, call->uniforms, (sg_view){0}, (sg_sampler){0}, SGNVG_PIP_FILL_STENCIL);
+    sgnvg__preparePipelineUniforms(ctx, 0, (sg_view){0}, (sg_sampler){0}, SGNVG_PIP_FILL_STENCIL);
     for (i = 0; i < npaths; i++)
         sg_draw(paths[i].fillOffset, paths[i].fillCount, 1);
 
     // if (ctx->flags & NVG_ANTIALIAS) {
-    sgnvg__preparePipelineUniforms(ctx, call->uniforms + 1, call->texview, call->smp, SGNVG_PIP_FILL_ANTIALIAS);
+    sgnvg__preparePipelineUniforms(ctx, 1, call->texview, call->smp, SGNVG_PIP_FILL_ANTIALIAS);
     // Draw fringes
     for (i = 0; i < npaths; i++)
         sg_draw(paths[i].strokeOffset, paths[i].strokeCount, 1);
     // }
 
     // Draw fill
-    sgnvg__preparePipelineUniforms(ctx, call->uniforms + 1, call->texview, call->smp, SGNVG_PIP_FILL_DRAW);
+    sgnvg__preparePipelineUniforms(ctx, 1, call->texview, call->smp, SGNVG_PIP_FILL_DRAW);
     sg_draw(call->triangleOffset, call->triangleCount, 1);
 }
 
-static void sgnvg__convexFill(NVGcontext* ctx, SGNVGcall* call)
+static void sgnvg__stencilStroke(NVGcontext* ctx, SGNVGcall* call)
 {
-    SGNVGpath* paths = call->paths;
-    int        i, npaths = call->num_paths;
+    SGNVGpath* paths  = call->paths;
+    int        npaths = call->num_paths, i;
+
+    NVG_ASSERT(ctx->flags & NVG_STENCIL_STROKES);
+    sgnvg__preparePipelineUniforms(ctx, 1, call->texview, call->smp, SGNVG_PIP_STROKE_STENCIL_DRAW);
 
-    sgnvg__preparePipelineUniforms(ctx, call->uniforms, call->texview, call->smp, SGNVG_PIP_BASE);
     for (i = 0; i < npaths; i++)
+        sg_draw(paths[i].strokeOffset, paths[i].strokeCount, 1);
+
+    // Draw anti-aliased pixels.
+    sgnvg__preparePipelineUniforms(ctx, 0, call->texview, call->smp, SGNVG_PIP_STROKE_STENCIL_ANTIALIAS);
+    for (i = 0; i < npaths; i++)
+        sg_draw(paths[i].strokeOffset, paths[i].strokeCount, 1);
+
+    // Clear stencil buffer.
+    sgnvg__preparePipelineUniforms(ctx, 0, (sg_view){0}, (sg_sampler){0}, SGNVG_PIP_STROKE_STENCIL_CLEAR);
+    for (i = 0; i < npaths; i++)
+        sg_draw(paths[i].strokeOffset, paths[i].strokeCount, 1);
+}
+
+// Index ranges drawn with the same pipeline & bindings. A range following on from the last becomes part of the same
+// sg_draw()
+typedef struct SGNVGdrawRun
+{
+    int start, end;
+} SGNVGdrawRun;
+
+static void sgnvg__flushRun(SGNVGdrawRun* run)
+{
+    if (run->end > run->start)
+        sg_draw(run->start, run->end - run->start, 1);
+    run->start = run->end = 0;
+}
+
+static void sgnvg__addRun(SGNVGdrawRun* run, int offset, int count)
+{
+    if (count <= 0)
+        return;
+    if (offset != run->end)
     {
-        sg_draw(paths[i].fillOffset, paths[i].fillCount, 1);
-        // Draw fringes
-        if (paths[i].strokeCount > 0)
+        sgnvg__flushRun(run);
+        run->start = run->end = offset;
+    }
+    run->end += count;
+}
+
+// Convex fills, strokes & triangles draw with SGNVG_PIP_BASE and one set of uniforms. Their vertices carry the index
+// of their uniforms, so consecutive calls sharing blend & texture only need the one pipeline & bindings
+static bool sgnvg__canBatch(NVGcontext* ctx, const SGNVGcall* a, const SGNVGcall* b)
+{
+    bool batchable = b->type == SGNVG_CONVEXFILL || b->type == SGNVG_TRIANGLES ||
+                     (b->type == SGNVG_STROKE && !(ctx->flags & NVG_STENCIL_STROKES));
+    return batchable && memcmp(&a->blendFunc, &b->blendFunc, sizeof(a->blendFunc)) == 0 &&
+           a->texview.id == b->texview.id && a->smp.id == b->smp.id;
+}
+
+static void sgnvg__addCallRuns(SGNVGdrawRun* run, const SGNVGcall* call)
+{
+    const SGNVGpath* paths = call->paths;
+    int              i;
+
+    switch (call->type)
+    {
+    case SGNVG_CONVEXFILL:
+        for (i = 0; i < call->num_paths; i++)
         {
-            sg_draw(paths[i].strokeOffset, paths[i].strokeCount, 1);
+            sgnvg__addRun(run, paths[i].fillOffset, paths[i].fillCount);
+            // Draw fringes
+            sgnvg__addRun(run, paths[i].strokeOffset, paths[i].strokeCount);
         }
+        break;
+    case SGNVG_STROKE:
+        for (i = 0; i < call->num_paths; i++)
+            sgnvg__addRun(run, paths[i].strokeOffset, paths[i].strokeCount);
+        break;
+    case SGNVG_TRIANGLES:
+        sgnvg__addRun(run, call->triangleOffset, call->triangleCount);
+        break;
+    default:
+        NVG_ASSERT(0);
     }
 }
 
-static void sgnvg__stroke(NVGcontext* ctx, SGNVGcall* call)
+static void sgnvg__shapes(NVGcontext* ctx, SGNVGcall* call)
 {
-    SGNVGpath* paths  = call->paths;
-    int        npaths = call->num_paths, i;
+    sg_view    texview = call->texview.id ? call->texview : ctx->dummyTexView;
+    sg_sampler smp     = call->smp.id ? call->smp : ctx->sampler_nearest;
 
-    if (ctx->flags & NVG_STENCIL_STROKES)
-    {
-        sgnvg__preparePipelineUniforms(
-            ctx,
-            call->uniforms + 1,
-            call->texview,
-            call->smp,
-            SGNVG_PIP_STROKE_STENCIL_DRAW);
+    sg_apply_pipeline(sgnvg__getPipelineFromCache(ctx, SGNVG_PIP_SHAPES));
 
-        for (i = 0; i < npaths; i++)
-            sg_draw(paths[i].strokeOffset, paths[i].strokeCount, 1);
+    nanovg_shapeParams_t params = {.u_sbo_offset = call->shapeOffset};
+    memcpy(params.u_viewSize, ctx->view.viewSize, sizeof(params.u_viewSize));
+    sg_apply_uniforms(UB_nanovg_shapeParams, &SG_RANGE(params));
+    ctx->frame_stats.uploaded_bytes += sizeof(params);
 
-        // Draw anti-aliased pixels.
-        sgnvg__preparePipelineUniforms(
-            ctx,
-            call->uniforms,
-            call->texview,
-            call->smp,
-            SGNVG_PIP_STROKE_STENCIL_ANTIALIAS);
-        for (i = 0; i < npaths; i++)
-            sg_draw(paths[i].strokeOffset, paths[i].strokeCount, 1);
-
-        // Clear stencil buffer.
-        sgnvg__preparePipelineUniforms(
-            ctx,
-            call->uniforms,
-            (sg_view){0},
-            (sg_sampler){0},
-            SGNVG_PIP_STROKE_STENCIL_CLEAR);
-        for (i = 0; i < npaths; i++)
-            sg_draw(paths[i].strokeOffset, paths[i].strokeCount, 1);
-    }
-    else
+    sg_apply_bindings(&(sg_bindings){
+        .views[VIEW_nanovg_sb_shapes] = ctx->shape_sbv,
+        .views[VIEW_nanovg_sb_frag]   = ctx->drawFragView,
+        .views[VIEW_nanovg_tex]       = texview,
+        .samplers[SMP_nanovg_smp]     = smp,
+    });
+
+    sg_draw(0, 6 * call->shapeCount, 1);
+}
+
+// Draws 'call' together with up to 'max_merged' compatible calls following it. Returns the number merged
+static int sgnvg__drawBatch(NVGcontext* ctx, SGNVGcall* call, int max_merged)
+{
+    SGNVGdrawRun run    = {0};
+    int          merged = 0;
+
+    sgnvg__preparePipelineUniforms(ctx, 0, call->texview, call->smp, SGNVG_PIP_BASE);
+    sgnvg__addCallRuns(&run, call);
+    for (SGNVGcall* next = call->next; next != NULL && merged < max_merged && sgnvg__canBatch(ctx, call, next);
+         next            = next->next)
     {
-        sgnvg__preparePipelineUniforms(ctx, call->uniforms, call->texview, call->smp, SGNVG_PIP_BASE);
-        // Draw Strokes
-        for (i = 0; i < npaths; i++)
-            sg_draw(paths[i].strokeOffset, paths[i].strokeCount, 1);
+        sgnvg__addCallRuns(&run, next);
+        merged++;
     }
+    sgnvg__flushRun(&run);
+
+    ctx->frame_stats.nvg_calls_merged += merged;
+    return merged;
 }
 
-static void sgnvg__triangles(NVGcontext* ctx, SGNVGcall* call)
+// Selects the pipeline cache entry used by the following draws
+static void sgnvg__setBlend(NVGcontext* ctx, SGNVGblend blend)
 {
-    sgnvg__preparePipelineUniforms(ctx, call->uniforms, call->texview, call->smp, SGNVG_PIP_BASE);
-    sg_draw(call->triangleOffset, call->triangleCount, 1);
+    ctx->blend.src_factor_rgb   = blend.srcRGB;
+    ctx->blend.dst_factor_rgb   = blend.dstRGB;
+    ctx->blend.src_factor_alpha = blend.srcAlpha;
+    ctx->blend.dst_factor_alpha = blend.dstAlpha;
+    ctx->pipelineCacheIndex     = sgnvg__getIndexFromCache(ctx, sgnvg__getCombinedBlendNumber(ctx->blend));
 }
 
-static void sgnvg__renderNVGCalls(NVGcontext* ctx, SGNVGcommandNVG* draws)
+static void sgnvg__renderNVGCalls(
+    NVGcontext*            ctx,
+    const SGNVGcommandNVG* draws,
+    sg_buffer              vertBuf,
+    sg_buffer              indexBuf,
+    sg_view                fragView)
 {
     SGNVGcall* call = draws->calls;
+    SGNVGblend blend = {0};
     int        i;
 
+    ctx->drawVertBuf  = vertBuf;
+    ctx->drawIndexBuf = indexBuf;
+    ctx->drawFragView = fragView;
+
     for (i = 0; i < draws->num_calls && call != NULL; i++)
     {
-        ctx->blend.src_factor_rgb   = call->blendFunc.srcRGB;
-        ctx->blend.dst_factor_rgb   = call->blendFunc.dstRGB;
-        ctx->blend.src_factor_alpha = call->blendFunc.srcAlpha;
-        ctx->blend.dst_factor_alpha = call->blendFunc.dstAlpha;
-        ctx->pipelineCacheIndex     = sgnvg__getIndexFromCache(ctx, sgnvg__getCombinedBlendNumber(ctx->blend));
+        // Only search the pipeline cache when the blend changes
+        if (i == 0 || memcmp(&call->blendFunc, &blend, sizeof(blend)) != 0)
+        {
+            blend = call->blendFunc;
+            sgnvg__setBlend(ctx, blend);
+        }
         switch (call->type)
         {
         case SGNVG_NONE:
@@ -4568,14 +7053,23 @@ static void sgnvg__renderNVGCalls(NVGcontext* ctx, SGNVGcommandNVG* draws)
         case SGNVG_FILL:
             sgnvg__fill(ctx, call);
             break;
-        case SGNVG_CONVEXFILL:
-            sgnvg__convexFill(ctx, call);
-            break;
         case SGNVG_STROKE:
-            sgnvg__stroke(ctx, call);
-            break;
+            if (ctx->flags & NVG_STENCIL_STROKES)
+            {
+                sgnvg__stencilStroke(ctx, call);
+                break;
+            }
+            // fallthrough
+        case SGNVG_CONVEXFILL:
         case SGNVG_TRIANGLES:
-            sgnvg__triangles(ctx, call);
+        {
+            int merged = sgnvg__drawBatch(ctx, call, draws->num_calls - i - 1);
+            for (; merged > 0; merged--, i++)
+                call = call->next;
+            break;
+        }
+        case SGNVG_SHAPES:
+            sgnvg__shapes(ctx, call);
             break;
         }
 
@@ -4584,6 +7078,54 @@ static void sgnvg__renderNVGCalls(NVGcontext* ctx, SGNVGcommandNVG* draws)
     NVG_ASSERT(i == draws->num_calls && call == NULL); // Oh oh, you built the list wrong
 }
 
+static void sgnvg__makeFragSBO(NVGcontext* ctx, size_t cap)
+{
+    ctx->frag_sbo = sg_make_buffer(&(sg_buffer_desc){
+        .usage.storage_buffer = true,
+        .usage.stream_update  = true,
+        .size                 = sizeof(SGNVGfragUniforms) * cap,
+        .label                = "nanovg.fragSBO",
+    });
+    xassert(ctx->frag_sbo.id);
+    ctx->frag_sbv = sg_make_view(&(sg_view_desc){
+        .storage_buffer = ctx->frag_sbo,
+    });
+    xassert(ctx->frag_sbv.id);
+    ctx->frag_sbo_cap = cap;
+}
+
+static void sgnvg__makeShapeSBO(NVGcontext* ctx, size_t cap)
+{
+    ctx->shape_sbo = sg_make_buffer(&(sg_buffer_desc){
+        .usage.storage_buffer = true,
+        .usage.stream_update  = true,
+        .size                 = sizeof(SGNVGshape) * cap,
+        .label                = "nanovg.shapeSBO",
+    });
+    xassert(ctx->shape_sbo.id);
+    ctx->shape_sbv = sg_make_view(&(sg_view_desc){
+        .storage_buffer = ctx->shape_sbo,
+    });
+    xassert(ctx->shape_sbv.id);
+    ctx->shape_sbo_cap = cap;
+}
+
+static void nvg__makeTextSBO(NVGcontext* ctx, size_t cap)
+{
+    ctx->text_sbo = sg_make_buffer(&(sg_buffer_desc){
+        .usage.storage_buffer = true,
+        .usage.stream_update  = true,
+        .size                 = sizeof(text_buffer_t) * cap,
+        .label                = "text SBO",
+    });
+    xassert(ctx->text_sbo.id);
+    ctx->text_sbv = sg_make_view(&(sg_view_desc){
+        .storage_buffer = ctx->text_sbo,
+    });
+    xassert(ctx->text_sbv.id);
+    ctx->text_sbo_cap = cap;
+}
+
 static void sgnvg__renderText(NVGcontext* ctx, SGNVGcommandText* cmdText)
 {
     sg_apply_pipeline(ctx->text_pip);
@@ -4591,7 +7133,11 @@ static void sgnvg__renderText(NVGcontext* ctx, SGNVGcommandText* cmdText)
     sg_bindings bind            = {0};
     bind.views[VIEW_sb_text]    = ctx->text_sbv;
     bind.views[VIEW_text_tex]   = cmdText->atlas_view;
+#ifdef NVG_FONT_FREETYPE_SDF
+    bind.samplers[SMP_text_smp] = ctx->sampler_linear; // distance fields are interpolated
+#else
     bind.samplers[SMP_text_smp] = ctx->sampler_nearest; // nearest neighbour
+#endif
 
     sg_apply_bindings(&bind);
 
@@ -4600,29 +7146,11 @@ static void sgnvg__renderText(NVGcontext* ctx, SGNVGcommandText* cmdText)
             {ctx->view.viewSize[0] * ctx->backingScaleFactor, ctx->view.viewSize[1] * ctx->backingScaleFactor},
         .u_view_size =
             {ctx->view.viewSize[2] * ctx->backingScaleFactor, ctx->view.viewSize[3] * ctx->backingScaleFactor},
-        .u_sbo_offset = cmdText->text_buffer_start,
+        .u_sbo_offset  = cmdText->text_buffer_start,
+        .u_glyph_scale = cmdText->glyph_scale,
     };
     sg_apply_uniforms(UB_vs_text_uniforms, &SG_RANGE(vs_text_uniforms));
 
-#ifdef NVG_FONT_FREETYPE_SINGLECHANNEL
-    fs_text_singlechannel_uniforms_t fs_text_singlechannel = {
-        .u_colour[0] = cmdText->colour_fill.rgba[0],
-        .u_colour[1] = cmdText->colour_fill.rgba[1],
-        .u_colour[2] = cmdText->colour_fill.rgba[2],
-        .u_colour[3] = cmdText->colour_fill.rgba[3],
-    };
-    sg_apply_uniforms(UB_fs_text_singlechannel_uniforms, &SG_RANGE(fs_text_singlechannel));
-#endif
-#ifdef NVG_FONT_FREETYPE_MULTICHANNEL
-    fs_text_multichannel_uniforms_t fs_text_multichannel = {
-        .u_colour[0] = cmdText->colour_fill.rgba[0],
-        .u_colour[1] = cmdText->colour_fill.rgba[1],
-        .u_colour[2] = cmdText->colour_fill.rgba[2],
-        .u_colour[3] = cmdText->colour_fill.rgba[3],
-    };
-    sg_apply_uniforms(UB_fs_text_multichannel_uniforms, &SG_RANGE(fs_text_multichannel));
-#endif
-
     int N_draws = cmdText->text_buffer_end - cmdText->text_buffer_start;
     sg_draw(0, 6 * N_draws, 1);
 }
@@ -4672,6 +7200,18 @@ static SGNVGblend sgnvg__blendCompositeOperation(NVGcompositeOperationState op)
     return blend;
 }
 
+void nvgWarmPipelines(NVGcontext* ctx, const int* ops, int nops)
+{
+    NVG_ASSERT(nops <= NANOVG_SG_PIPELINE_CACHE_SIZE); // Later ops would evict earlier ones
+    for (int i = 0; i < nops; i++)
+    {
+        sgnvg__setBlend(ctx, sgnvg__blendCompositeOperation(nvg__compositeOperationState(ops[i])));
+        for (enum SGNVGpipelineType t = 0; t < SGNVG_PIP_NUM_; t++)
+            if (sgnvg__pipelineTypeIsInUse(ctx, t))
+                sgnvg__getPipelineFromCache(ctx, t);
+    }
+}
+
 void nvgBeginFrame(NVGcontext* ctx, int backingScaleFactor)
 {
     nvgReset(ctx);
@@ -4688,20 +7228,120 @@ void nvgBeginFrame(NVGcontext* ctx, int backingScaleFactor)
     ctx->frame_stats.fillTriCount   = 0;
     ctx->frame_stats.strokeTriCount = 0;
     ctx->frame_stats.textTriCount   = 0;
-    ctx->frame_stats.textTriCount   = 0;
     ctx->frame_stats.uploaded_bytes = 0;
 
+    // Bursts like nvgLoadGlyphCache() can stage a band for every row of every page. Keep only what last frame used
+    nvg__trimAtlasStaging(ctx, ctx->atlas_upload.num_staging_used);
+    ctx->atlas_upload.num_staging_used = 0;
+
+    ctx->frame_stats.glyph_cache_hits      = 0;
+    ctx->frame_stats.glyph_cache_misses    = 0;
+    ctx->frame_stats.glyph_atlas_evictions = 0;
+    ctx->frame_stats.glyph_atlas_pages     = xarr_len(ctx->glyph_atlases);
+    ctx->frame_stats.layout_cache_hits     = 0;
+    ctx->frame_stats.layout_cache_misses   = 0;
+    ctx->frame_stats.text_draws_merged     = 0;
+    ctx->frame_stats.nvg_calls_merged      = 0;
+    ctx->frame_stats.shapes_drawn          = 0;
+    ctx->frame_stats.fills_triangulated    = 0;
+    ctx->frame_stats.pipelines_created     = 0;
+    ctx->frame_stats.stream_buffer_resizes = 0;
+
+    ctx->frame_id++;
+#ifdef NVG_FONT_FREETYPE
+    ctx->frame_stats.glyph_async_queued = 0;
+    ctx->frame_stats.glyph_async_landed = 0;
+    if (ctx->glyph_worker)
+        nvg__glyphWorkerDrain(ctx);
+#endif
+    if (ctx->frame_id - ctx->layout_cache.generation_start_frame >= NVG_LAYOUT_CACHE_GENERATION_FRAMES)
+        nvg__layoutCacheNextGeneration(ctx);
+
     // Reset calls
-    ctx->nverts          = 0;
-    ctx->nindexes        = 0;
-    ctx->first_command   = NULL;
-    ctx->text_buffer_len = 0;
+    ctx->nverts        = 0;
+    ctx->nindexes      = 0;
+    ctx->first_command = NULL;
+    xarr_setlen(ctx->text_buffer, 0);
+    xarr_setlen(ctx->frag_uniforms, 0);
+    xarr_setlen(ctx->shapes, 0);
 
     linked_arena_clear(ctx->frame_arena);
 
     nvg__setBackingScaleFactor(ctx, backingScaleFactor);
 }
 
+// Sizes a streamed buffer for 'needed' elements this frame. Grows geometrically. Shrinks to half once it has been
+// under a quarter full for NVG_STREAM_SHRINK_FRAMES frames in a row, so one busy frame doesn't keep it large forever
+static void sgnvg__resizeStreamBuffer(
+    NVGcontext* ctx,
+    sg_buffer   buf,
+    int*        cap,
+    int*        idle_frames,
+    int         needed,
+    size_t      stride,
+    bool        index,
+    const char* label)
+{
+    int new_cap = *cap;
+
+    if (needed > *cap)
+    {
+        new_cap      = nvg__maxi(nvg__maxi(needed, *cap * 2), 4096);
+        *idle_frames = 0;
+    }
+    else if (needed < *cap / 4 && *cap > 4096)
+    {
+        if (++*idle_frames >= NVG_STREAM_SHRINK_FRAMES)
+        {
+            new_cap      = nvg__maxi(*cap / 2, 4096);
+            *idle_frames = 0;
+        }
+    }
+    else
+    {
+        *idle_frames = 0;
+    }
+    if (new_cap == *cap)
+        return;
+
+    if (*cap) // delete old buffer if necessary
+        sg_uninit_buffer(buf);
+    *cap = new_cap;
+    sg_init_buffer(
+        buf,
+        &(sg_buffer_desc){
+            .size                = new_cap * stride,
+            .usage.vertex_buffer = !index,
+            .usage.index_buffer  = index,
+            .usage.stream_update = true,
+            .label               = label,
+        });
+    ctx->frame_stats.stream_buffer_resizes++;
+}
+
+// Appends frame vertices & indexes before 'nverts' & 'nindexes' that aren't on the GPU yet, so each pass uploads
+// only what it draws. Appends restart at 0 every frame & follow on from each other, so everything lands at the same
+// offset as in ctx->verts & ctx->indexes and calls need no rebasing
+static void sgnvg__appendGeometry(NVGcontext* ctx, int nverts, int nindexes)
+{
+    if (nverts > ctx->nverts_gpu)
+    {
+        sg_range range = {ctx->verts + ctx->nverts_gpu, (nverts - ctx->nverts_gpu) * sizeof(*ctx->verts)};
+        int      off   = sg_append_buffer(ctx->vertBuf, &range);
+        NVG_ASSERT((size_t)off == ctx->nverts_gpu * sizeof(*ctx->verts));
+        ctx->frame_stats.uploaded_bytes += range.size;
+        ctx->nverts_gpu                  = nverts;
+    }
+    if (nindexes > ctx->nindexes_gpu)
+    {
+        sg_range range = {ctx->indexes + ctx->nindexes_gpu, (nindexes - ctx->nindexes_gpu) * sizeof(*ctx->indexes)};
+        int      off   = sg_append_buffer(ctx->indexBuf, &range);
+        NVG_ASSERT((size_t)off == ctx->nindexes_gpu * sizeof(*ctx->indexes));
+        ctx->frame_stats.uploaded_bytes += range.size;
+        ctx->nindexes_gpu                = nindexes;
+    }
+}
+
 int snvg_consume_commands(NVGcontext* ctx, SGNVGcommand* cmd)
 {
     int ncommands = 0;
@@ -4726,11 +7366,34 @@ int snvg_consume_commands(NVGcontext* ctx, SGNVGcommand* cmd)
             sg_end_pass();
             break;
         case SGNVG_CMD_DRAW_NVG:
-            sgnvg__renderNVGCalls(ctx, cmd->payload.drawNVG);
+            sgnvg__appendGeometry(ctx, cmd->payload.drawNVG->vert_end, cmd->payload.drawNVG->index_end);
+            sgnvg__renderNVGCalls(ctx, cmd->payload.drawNVG, ctx->vertBuf, ctx->indexBuf, ctx->frag_sbv);
+            break;
+        case SGNVG_CMD_DRAW_LIST:
+        {
+            const NVGdisplayList* list = cmd->payload.list;
+            if (list->draws.num_calls > 0)
+                sgnvg__renderNVGCalls(ctx, &list->draws, list->vertBuf, list->indexBuf, list->fragView);
             break;
+        }
         case SGNVG_CMD_DRAW_TEXT:
-            sgnvg__renderText(ctx, cmd->payload.text);
+        {
+            // Glyphs carry their own colour, so consecutive text draws on the same atlas can become one draw
+            SGNVGcommandText* cmdText = cmd->payload.text;
+            while (cmd->next != NULL && cmd->next->type == SGNVG_CMD_DRAW_TEXT)
+            {
+                const SGNVGcommandText* next = cmd->next->payload.text;
+                if (next->atlas_view.id != cmdText->atlas_view.id ||
+                    next->text_buffer_start != cmdText->text_buffer_end ||
+                    next->glyph_scale != cmdText->glyph_scale)
+                    break;
+                cmdText->text_buffer_end = next->text_buffer_end;
+                cmd                      = cmd->next;
+                ctx->frame_stats.text_draws_merged++;
+            }
+            sgnvg__renderText(ctx, cmdText);
             break;
+        }
         case SGNVG_CMD_IMAGE_FX:
         {
             SGNVGcommandImageFX* cmdfx = cmd->payload.fx;
@@ -4754,28 +7417,73 @@ int snvg_consume_commands(NVGcontext* ctx, SGNVGcommand* cmd)
 
 void nvgEndFrame(NVGcontext* ctx)
 {
+    NVG_ASSERT(!ctx->list_recording.active); // Missing nvgEndDisplayList()
+
     size_t num_atlases = xarr_len(ctx->glyph_atlases);
     for (int i = 0; i < num_atlases; i++)
     {
-        NVGatlas* atlas = ctx->glyph_atlases + ctx->current_atlas.idx;
-        if (atlas->dirty)
+        NVGatlas* atlas = ctx->glyph_atlases + i;
+        if (atlas->dirty.num)
         {
-            sg_view_desc view_desc = sg_query_view_desc(atlas->img_view);
-            sg_update_image(
-                view_desc.texture.image,
-                &(sg_image_data){
-                    .mip_levels[0] = {
-                        .ptr  = ctx->current_atlas.img_data,
-                        .size = NVG_ATLAS_HEIGHT * NVG_ATLAS_ROW_STRIDE,
-                    }});
-            atlas->dirty = false;
+            // Pages are staged as soon as they fill up. Only the current page has pixels on the CPU
+            NVG_ASSERT(i == ctx->current_atlas.idx);
+            ctx->frame_stats.uploaded_bytes += nvg__stageAtlasUpload(ctx, i, ctx->current_atlas.img_data);
         }
     }
+    nvg__drawAtlasUploads(ctx);
 
-    if (ctx->text_buffer_len)
+    const size_t num_text_glyphs = xarr_len(ctx->text_buffer);
+    if (num_text_glyphs)
     {
-        sg_range sbo_range = {.ptr = ctx->text_buffer, .size = sizeof(ctx->text_buffer[0]) * ctx->text_buffer_len};
+        if (num_text_glyphs > ctx->text_sbo_cap)
+        {
+            // Storage buffers can't be resized. Make a bigger one
+            size_t cap = ctx->text_sbo_cap;
+            while (cap < num_text_glyphs)
+                cap *= 2;
+            sg_destroy_view(ctx->text_sbv);
+            sg_destroy_buffer(ctx->text_sbo);
+            nvg__makeTextSBO(ctx, cap);
+        }
+        sg_range sbo_range = {.ptr = ctx->text_buffer, .size = sizeof(ctx->text_buffer[0]) * num_text_glyphs};
         sg_update_buffer(ctx->text_sbo, &sbo_range);
+        ctx->frame_stats.uploaded_bytes += sbo_range.size;
+    }
+
+    const size_t num_frag_uniforms = xarr_len(ctx->frag_uniforms);
+    if (num_frag_uniforms)
+    {
+        if (num_frag_uniforms > ctx->frag_sbo_cap)
+        {
+            // Storage buffers can't be resized. Make a bigger one
+            size_t cap = ctx->frag_sbo_cap;
+            while (cap < num_frag_uniforms)
+                cap *= 2;
+            sg_destroy_view(ctx->frag_sbv);
+            sg_destroy_buffer(ctx->frag_sbo);
+            sgnvg__makeFragSBO(ctx, cap);
+        }
+        sg_range sbo_range = {.ptr = ctx->frag_uniforms, .size = sizeof(*ctx->frag_uniforms) * num_frag_uniforms};
+        sg_update_buffer(ctx->frag_sbo, &sbo_range);
+        ctx->frame_stats.uploaded_bytes += sbo_range.size;
+    }
+
+    const size_t num_shapes = xarr_len(ctx->shapes);
+    if (num_shapes)
+    {
+        if (num_shapes > ctx->shape_sbo_cap)
+        {
+            // Storage buffers can't be resized. Make a bigger one
+            size_t cap = ctx->shape_sbo_cap;
+            while (cap < num_shapes)
+                cap *= 2;
+            sg_destroy_view(ctx->shape_sbv);
+            sg_destroy_buffer(ctx->shape_sbo);
+            sgnvg__makeShapeSBO(ctx, cap);
+        }
+        sg_range sbo_range = {.ptr = ctx->shapes, .size = sizeof(*ctx->shapes) * num_shapes};
+        sg_update_buffer(ctx->shape_sbo, &sbo_range);
+        ctx->frame_stats.uploaded_bytes += sbo_range.size;
     }
 
     for (int i = 0; i < ctx->ntextures; i++)
@@ -4787,55 +7495,36 @@ void nvgEndFrame(NVGcontext* ctx)
             if (tex->flags & NVG_IMAGE_DIRTY)
             {
                 NVG_ASSERT(tex->imgData != NULL);
-                tex->flags      ^= NVG_IMAGE_DIRTY;
-                int    channels  = tex->type == NVG_TEXTURE_RGBA ? 4 : 1;
-                size_t nbytes    = tex->width * tex->height * channels;
+                tex->flags     ^= NVG_IMAGE_DIRTY;
+                int channels    = tex->type == NVG_TEXTURE_RGBA ? 4 : 1;
 
-                ctx->frame_stats.uploaded_bytes += nbytes;
-                sg_update_image(tex->img, &(sg_image_data){.mip_levels[0] = {tex->imgData, nbytes}});
+                ctx->frame_stats.uploaded_bytes +=
+                    nvg__uploadDirtyRects(tex->img, tex->imgData, tex->width, tex->height, channels, &tex->dirty);
             }
         }
     }
 
-    if (ctx->cverts_gpu < ctx->nverts) // resize GPU vertex buffer
-    {
-        if (ctx->cverts_gpu) // delete old buffer if necessary
-            sg_uninit_buffer(ctx->vertBuf);
-        ctx->cverts_gpu = ctx->cverts;
-        sg_init_buffer(
-            ctx->vertBuf,
-            &(sg_buffer_desc){
-                .size                = ctx->cverts_gpu * sizeof(*ctx->verts),
-                .usage.vertex_buffer = true,
-                .usage.stream_update = true,
-                .label               = NVG_LABEL("nanovg.vertBuf"),
-            });
-    }
-    // upload vertex data
-    size_t nbytes                    = ctx->nverts * sizeof(*ctx->verts);
-    ctx->frame_stats.uploaded_bytes += nbytes;
-    if (nbytes)
-        sg_update_buffer(ctx->vertBuf, &(sg_range){ctx->verts, nbytes});
-
-    if (ctx->cindexes_gpu < ctx->nindexes) // resize GPU index buffer
-    {
-        if (ctx->cindexes_gpu) // delete old buffer if necessary
-            sg_uninit_buffer(ctx->indexBuf);
-        ctx->cindexes_gpu = ctx->cindexes;
-        sg_init_buffer(
-            ctx->indexBuf,
-            &(sg_buffer_desc){
-                .size                = ctx->cindexes_gpu * sizeof(*ctx->indexes),
-                .usage.index_buffer  = true,
-                .usage.stream_update = true,
-                .label               = NVG_LABEL("nanovg.indexBuf"),
-            });
-    }
-    // upload index data
-    nbytes                           = ctx->nindexes * sizeof(*ctx->indexes);
-    ctx->frame_stats.uploaded_bytes += nbytes;
-    if (nbytes)
-        sg_update_buffer(ctx->indexBuf, &(sg_range){ctx->indexes, nbytes});
+    // Size the streamed buffers for the whole frame. Each nvg draw appends its own geometry as it's drawn
+    sgnvg__resizeStreamBuffer(
+        ctx,
+        ctx->vertBuf,
+        &ctx->cverts_gpu,
+        &ctx->idle_verts_gpu,
+        ctx->nverts,
+        sizeof(*ctx->verts),
+        false,
+        NVG_LABEL("nanovg.vertBuf"));
+    sgnvg__resizeStreamBuffer(
+        ctx,
+        ctx->indexBuf,
+        &ctx->cindexes_gpu,
+        &ctx->idle_indexes_gpu,
+        ctx->nindexes,
+        sizeof(*ctx->indexes),
+        true,
+        NVG_LABEL("nanovg.indexBuf"));
+    ctx->nverts_gpu   = 0;
+    ctx->nindexes_gpu = 0;
 
     int ncommands = snvg_consume_commands(ctx, ctx->first_command);
 
@@ -4879,11 +7568,16 @@ static void sgnvg__addCall(NVGcontext* ctx, SGNVGcall* call)
         ctx->current_nvg_draw->num_calls++;
         if (ctx->current_nvg_draw->calls == NULL)
             ctx->current_nvg_draw->calls = call;
+        ctx->current_nvg_draw->vert_end  = ctx->nverts;
+        ctx->current_nvg_draw->index_end = ctx->nindexes;
     }
 }
 
 SGNVGcommand* sgnvg__allocCommand(NVGcontext* ctx, enum SGNVGcommandType type, const char* label)
 {
+    // Only fills & strokes can be recorded into a display list
+    NVG_ASSERT(!ctx->list_recording.active);
+
     SGNVGcommand* cmd = linked_arena_alloc_clear(ctx->frame_arena, sizeof(*cmd));
 
     cmd->type  = type;
@@ -4945,12 +7639,30 @@ static int sgnvg__allocIndexes(NVGcontext* ctx, int n)
     return ret;
 }
 
-static void sgnvg__vset(SGNVGattribute* vtx, float x, float y, float u, float v)
+static void sgnvg__vset(SGNVGattribute* vtx, float x, float y, float u, float v, int frag)
 {
     vtx->vertex[0] = x;
     vtx->vertex[1] = y;
     vtx->tcoord[0] = u;
     vtx->tcoord[1] = v;
+    vtx->frag      = frag;
+}
+
+// Copies path vertices into the frame's vertices, tagged with the index of their call's uniforms
+static void sgnvg__copyVerts(SGNVGattribute* dst, const NVGvertex* src, int n, int frag)
+{
+    for (int i = 0; i < n; i++)
+        sgnvg__vset(&dst[i], src[i].x, src[i].y, src[i].u, src[i].v, frag);
+}
+
+// Appends 'n' zeroed uniforms to the frame's uniforms for 'call'. The pointer is valid until the next append
+static SGNVGfragUniforms* sgnvg__allocUniforms(NVGcontext* ctx, SGNVGcall* call, int n)
+{
+    const size_t len = xarr_len(ctx->frag_uniforms);
+    xarr_setlen(ctx->frag_uniforms, len + n);
+    memset(ctx->frag_uniforms + len, 0, sizeof(*ctx->frag_uniforms) * n);
+    call->uniformOffset = len;
+    return ctx->frag_uniforms + len;
 }
 
 static void sgnvg__generateTriangleFanIndexes(uint32_t* indexes, int offset, int nverts)
@@ -4962,58 +7674,252 @@ static void sgnvg__generateTriangleFanIndexes(uint32_t* indexes, int offset, int
         indexes[3 * (i - 2) + 1] = offset + i - 1;
         indexes[3 * (i - 2) + 2] = offset + i;
     }
-}
+}
+
+static void sgnvg__generateTriangleStripIndexes(uint32_t* indexes, int offset, int nverts)
+{
+    // following triangles all use previous 2 vertices, and current vertex
+    // we use bit-shifts to get the sequence:
+    // i  idx i(bits)   i-1(bits)   i-2(bits)
+    // 2: 012 0010      0001        0000
+    // 3: 213 0011      0010        0001
+    // 4: 234 0100      0011        0010
+    // 5: 435 0101      0100        0011
+    // 6: 456 0110      0101        0100
+    // 7: 657 0111      0110        0101
+    //                  first index = above & ~1 = floor_to_even(i-1)
+    //                              second index = above | 1 = ceil_to_even(i-2)
+    // all this trickery ensures that we maintain correct (CCW) vertex order
+    for (int i = 2; i < nverts; i++)
+    {
+        indexes[3 * (i - 2) + 0] = offset + ((i - 1) & ~1);
+        indexes[3 * (i - 2) + 1] = offset + ((i - 2) | 1);
+        indexes[3 * (i - 2) + 2] = offset + i;
+    }
+}
+
+// Quad covering the fill's bounds, drawn through the stencil left by its paths
+static void sgnvg__setBoundsQuad(NVGcontext* ctx, SGNVGcall* call, int offset, int ioffset, const float* bounds)
+{
+    SGNVGattribute* quad = &ctx->verts[offset];
+    int             frag = call->uniformOffset;
+
+    call->triangleOffset = ioffset;
+    call->triangleCount  = (call->triangleCount - 2) * 3; // convert vertex count into index
+    sgnvg__vset(&quad[0], bounds[2], bounds[3], 0.5f, 1.0f, frag);
+    sgnvg__vset(&quad[1], bounds[2], bounds[1], 0.5f, 1.0f, frag);
+    sgnvg__vset(&quad[2], bounds[0], bounds[3], 0.5f, 1.0f, frag);
+    sgnvg__vset(&quad[3], bounds[0], bounds[1], 0.5f, 1.0f, frag);
+    sgnvg__generateTriangleStripIndexes(&ctx->indexes[ioffset], offset, 4);
+}
+
+static void sgnvg__setFillUniforms(NVGcontext* ctx, SGNVGcall* call, NVGpaint* paint, float fringe)
+{
+    NVGscissor*        scissor = &ctx->state.scissor;
+    SGNVGfragUniforms* frag    = NULL;
+
+    if (call->type == SGNVG_FILL)
+    {
+        frag = sgnvg__allocUniforms(ctx, call, 2);
+
+        // Simple shader for stencil
+        frag->strokeThr = -1.0f;
+        frag->type      = NSVG_SHADER_SIMPLE;
+        // Fill shader
+        sgnvg__convertPaint(ctx, frag + 1, paint, scissor, fringe, fringe, -1.0f);
+    }
+    else
+    {
+        frag = sgnvg__allocUniforms(ctx, call, 1);
+        // Fill shader
+        sgnvg__convertPaint(ctx, frag, paint, scissor, fringe, fringe, -1.0f);
+    }
+}
+
+static void
+sgnvg__setStrokeUniforms(NVGcontext* ctx, SGNVGcall* call, NVGpaint* paint, float strokeWidth, float fringe)
+{
+    NVGscissor*        scissor = &ctx->state.scissor;
+    SGNVGfragUniforms* frags   = NULL;
+
+    if (ctx->flags & NVG_STENCIL_STROKES)
+    {
+        // Fill shader
+        frags = sgnvg__allocUniforms(ctx, call, 2);
+
+        sgnvg__convertPaint(ctx, frags, paint, scissor, strokeWidth, fringe, -1.0f);
+        sgnvg__convertPaint(ctx, frags + 1, paint, scissor, strokeWidth, fringe, 1.0f - 0.5f / 255.0f);
+    }
+    else
+    {
+        // Fill shader
+        frags = sgnvg__allocUniforms(ctx, call, 1);
+        sgnvg__convertPaint(ctx, frags, paint, scissor, strokeWidth, fringe, -1.0f);
+    }
+}
+
+// Stroke width in device pixels. Strokes thinner than a pixel are drawn a pixel wide with reduced coverage
+static float nvg__deviceStrokeWidth(NVGcontext* ctx, float stroke_width, float* coverage)
+{
+    float scale       = nvg__getAverageScale(ctx->state.xform);
+    float strokeWidth = nvg__clampf(stroke_width * scale, 0.0f, 200.0f);
+
+    *coverage = 1.0f;
+    if (strokeWidth < ctx->fringeWidth)
+    {
+        // If the stroke width is less than pixel size, use alpha to emulate coverage.
+        // Since coverage is area, scale by alpha*alpha.
+        float alpha = nvg__clampf(strokeWidth / ctx->fringeWidth, 0.0f, 1.0f);
+        *coverage   = alpha * alpha;
+        strokeWidth = ctx->fringeWidth;
+    }
+    return strokeWidth;
+}
+
+// Draws the current path as an SGNVGshape if nvg__setShapeHint() marked it as one. Returns false if it must be
+// tessellated. 'stroke_width' is 0 for fills
+static bool nvg__drawShape(NVGcontext* ctx, float stroke_width)
+{
+    NVGstate*  state     = &ctx->state;
+    const bool stroke    = stroke_width > 0.0f;
+    const bool roundJoin = state->lineJoin == NVG_ROUND;
+
+    // Display lists only keep tessellated calls
+    if (ctx->shape_hint.ncommands != ctx->ncommands || ctx->list_recording.active)
+        return false;
+    // Bevels cut the square corners of a stroked rect. Right angle miters become bevels below a limit of sqrt(2)
+    if (stroke && !roundJoin && (state->lineJoin != NVG_MITER || state->miterLimit * state->miterLimit * 0.5f < 1.0f))
+        return false;
+
+    NVGpaint          paint       = state->paint;
+    float             coverage    = 1.0f;
+    float             strokeWidth = stroke ? nvg__deviceStrokeWidth(ctx, stroke_width, &coverage) : 0.0f;
+    SGNVGblend        blendFunc   = sgnvg__blendCompositeOperation(state->compositeOperation);
+    SGNVGcall*        call        = NULL;
+    SGNVGfragUniforms frag;
+    int               fragIndex = -1;
+
+    paint.innerColour.a *= coverage;
+    paint.outerColour.a *= coverage;
+    sgnvg__convertPaint(
+        ctx,
+        &frag,
+        &paint,
+        &state->scissor,
+        stroke ? strokeWidth : ctx->fringeWidth,
+        ctx->fringeWidth,
+        -1.0f);
+
+    if (ctx->current_nvg_draw == NULL)
+        snvg_command_draw_nvg(ctx, stroke ? NVG_LABEL("nvgStroke") : NVG_LABEL("nvgFill"));
+
+    // Consecutive shapes sharing blend & texture are one draw
+    call = ctx->current_call;
+    if (call == NULL || call->type != SGNVG_SHAPES || memcmp(&call->blendFunc, &blendFunc, sizeof(blendFunc)) != 0 ||
+        call->texview.id != paint.texview.id || call->smp.id != paint.smp.id)
+    {
+        call = linked_arena_alloc_clear(ctx->frame_arena, sizeof(*call));
+        if (call == NULL)
+            return true;
+        call->type        = SGNVG_SHAPES;
+        call->texview     = paint.texview;
+        call->smp         = paint.smp;
+        call->blendFunc   = blendFunc;
+        call->shapeOffset = xarr_len(ctx->shapes);
+        sgnvg__addCall(ctx, call);
+    }
+    NVG_ASSERT(call->shapeOffset + call->shapeCount == xarr_len(ctx->shapes));
 
-static void sgnvg__generateTriangleStripIndexes(uint32_t* indexes, int offset, int nverts)
-{
-    // following triangles all use previous 2 vertices, and current vertex
-    // we use bit-shifts to get the sequence:
-    // i  idx i(bits)   i-1(bits)   i-2(bits)
-    // 2: 012 0010      0001        0000
-    // 3: 213 0011      0010        0001
-    // 4: 234 0100      0011        0010
-    // 5: 435 0101      0100        0011
-    // 6: 456 0110      0101        0100
-    // 7: 657 0111      0110        0101
-    //                  first index = above & ~1 = floor_to_even(i-1)
-    //                              second index = above | 1 = ceil_to_even(i-2)
-    // all this trickery ensures that we maintain correct (CCW) vertex order
-    for (int i = 2; i < nverts; i++)
+    // Runs of shapes often share a paint
+    if (call->shapeCount > 0)
     {
-        indexes[3 * (i - 2) + 0] = offset + ((i - 1) & ~1);
-        indexes[3 * (i - 2) + 1] = offset + ((i - 2) | 1);
-        indexes[3 * (i - 2) + 2] = offset + i;
+        int prev = (int)ctx->shapes[call->shapeOffset + call->shapeCount - 1].frag;
+        if (memcmp(&ctx->frag_uniforms[prev], &frag, sizeof(frag)) == 0)
+            fragIndex = prev;
+    }
+    if (fragIndex < 0)
+    {
+        SGNVGfragUniforms* dst = sgnvg__allocUniforms(ctx, call, 1);
+        *dst                   = frag;
+        fragIndex              = call->uniformOffset;
     }
+
+    const size_t len = xarr_len(ctx->shapes);
+    xarr_setlen(ctx->shapes, len + 1);
+
+    SGNVGshape* shape = ctx->shapes + len;
+    memcpy(shape->rect, ctx->shape_hint.rect, sizeof(shape->rect));
+    memcpy(shape->radii, ctx->shape_hint.radii, sizeof(shape->radii));
+    shape->halfStroke = strokeWidth * 0.5f;
+    shape->frag       = fragIndex;
+    shape->fringe     = ctx->edgeAntiAlias && state->shapeAntiAlias ? ctx->fringeWidth : 0.0f;
+    shape->roundJoin  = roundJoin ? 1.0f : 0.0f;
+
+    call->shapeCount++;
+    ctx->frame_stats.shapes_drawn++;
+    return true;
 }
 
 void nvgFill(NVGcontext* ctx)
 {
     NVGstate* state = &ctx->state;
 
-    if (ctx->ncommands == 0)
+    if (ctx->ncommands == 0 || nvg__drawShape(ctx, 0.0f))
         return;
 
     const NVGpath* path;
     NVGpaint       paint             = state->paint;
     float          expandFringeWidth = 0;
-    int            i;
+    int            ntris             = 0;
+    int            convex, i;
 
     nvg__flattenPaths(ctx);
     if (ctx->edgeAntiAlias && state->shapeAntiAlias)
         expandFringeWidth = ctx->fringeWidth;
-    nvg__expandFill(ctx, expandFringeWidth, NVG_MITER, 2.4f);
+
+    convex = ctx->cache.npaths == 1 && ctx->cache.paths[0].convex;
+
+    bool      triangulate = !convex && ctx->cache.npaths == 1 && (ctx->flags & NVG_TRIANGULATE_CONCAVE) &&
+                            !ctx->cache.paths[0].triangulate_failed;
+    uint64_t  hash        = 0;
+    uint64_t* failure     = NULL;
+    if (triangulate)
+    {
+        // Paths redrawn every frame are rebuilt every frame. Known failures skip another O(n^2) attempt & expansion
+        hash        = nvg__hashBytes(0xcbf29ce484222325ull, ctx->commands, sizeof(*ctx->commands) * ctx->ncommands);
+        failure     = ctx->triangulate_failures + hash % NVG_TRIANGULATE_FAILURES;
+        triangulate = *failure != hash;
+    }
+    if (triangulate)
+    {
+        // Ear clip the outline to draw it like a convex fill. Failing that, expand again with the stencil fill's fringe
+        nvg__expandFill(ctx, expandFringeWidth, NVG_MITER, 2.4f, 1);
+        ntris  = nvg__triangulateFill(ctx, &ctx->cache.paths[0]);
+        convex = ntris > 0;
+        if (convex)
+        {
+            ctx->frame_stats.fills_triangulated++;
+        }
+        else
+        {
+            *failure                               = hash;
+            ctx->cache.paths[0].triangulate_failed = 1;
+            nvg__expandFill(ctx, expandFringeWidth, NVG_MITER, 2.4f, 0);
+        }
+    }
+    else
+    {
+        nvg__expandFill(ctx, expandFringeWidth, NVG_MITER, 2.4f, convex);
+    }
 
     NVGcompositeOperationState compositeOperation = state->compositeOperation;
-    NVGscissor*                scissor            = &state->scissor;
     float                      fringe             = ctx->fringeWidth;
     const float*               bounds             = ctx->cache.bounds;
     const NVGpath*             paths              = ctx->cache.paths;
     int                        npaths             = ctx->cache.npaths;
 
-    SGNVGcall*         call = NULL;
-    SGNVGattribute*    quad = NULL;
-    SGNVGfragUniforms* frag = NULL;
-    int                maxverts, offset, maxindexes, ioffset;
+    SGNVGcall* call = NULL;
+    int        maxverts, offset, maxindexes, ioffset;
 
     // Looks like you forgot to call snvg_command_draw_nvg() before issuing nvgFill()/nvgStroke()/nvgText() commands!
     // NVG_ASSERT(ctx->current_nvg_draw != NULL); // TODO: remove?
@@ -5035,12 +7941,15 @@ void nvgFill(NVGcontext* ctx)
     call->smp       = paint.smp;
     call->blendFunc = sgnvg__blendCompositeOperation(compositeOperation);
 
-    if (npaths == 1 && paths[0].convex)
+    if (convex)
     {
         call->type          = SGNVG_CONVEXFILL;
         call->triangleCount = 0; // Bounding box fill quad not needed for convex fill
     }
 
+    // Setup uniforms for draw calls. Vertices are tagged with their index
+    sgnvg__setFillUniforms(ctx, call, &paint, fringe);
+
     // Allocate vertices for all the paths.
     maxverts = sgnvg__maxVertCount(paths, npaths) + call->triangleCount;
     offset   = sgnvg__allocVerts(ctx, maxverts);
@@ -5057,11 +7966,20 @@ void nvgFill(NVGcontext* ctx)
         path            = &paths[i];
         if (path->nfill > 0)
         {
-            // fill: triangle fan
+            // fill: triangle fan, or the ear clipped triangles of a concave outline
             copy->fillOffset = ioffset;
             copy->fillCount  = (path->nfill - 2) * 3;
-            memcpy(&ctx->verts[offset], path->fill, sizeof(NVGvertex) * path->nfill);
-            sgnvg__generateTriangleFanIndexes(&ctx->indexes[ioffset], offset, path->nfill);
+            sgnvg__copyVerts(&ctx->verts[offset], path->fill, path->nfill, call->uniformOffset);
+            if (ntris > 0)
+            {
+                NVG_ASSERT(ntris == copy->fillCount);
+                for (int k = 0; k < ntris; k++)
+                    ctx->indexes[ioffset + k] = offset + ctx->cache.tris[k];
+            }
+            else
+            {
+                sgnvg__generateTriangleFanIndexes(&ctx->indexes[ioffset], offset, path->nfill);
+            }
             offset  += path->nfill;
             ioffset += copy->fillCount;
         }
@@ -5070,47 +7988,15 @@ void nvgFill(NVGcontext* ctx)
             // stroke: triangle strip
             copy->strokeOffset = ioffset;
             copy->strokeCount  = (path->nstroke - 2) * 3;
-            memcpy(&ctx->verts[offset], path->stroke, sizeof(NVGvertex) * path->nstroke);
+            sgnvg__copyVerts(&ctx->verts[offset], path->stroke, path->nstroke, call->uniformOffset);
             sgnvg__generateTriangleStripIndexes(&ctx->indexes[ioffset], offset, path->nstroke);
             offset  += path->nstroke;
             ioffset += copy->strokeCount;
         }
     }
 
-    // Setup uniforms for draw calls
     if (call->type == SGNVG_FILL)
-    {
-        // Quad
-        call->triangleOffset = ioffset;
-        call->triangleCount  = (call->triangleCount - 2) * 3; // convert vertex count into index
-        quad                 = &ctx->verts[offset];
-        sgnvg__vset(&quad[0], bounds[2], bounds[3], 0.5f, 1.0f);
-        sgnvg__vset(&quad[1], bounds[2], bounds[1], 0.5f, 1.0f);
-        sgnvg__vset(&quad[2], bounds[0], bounds[3], 0.5f, 1.0f);
-        sgnvg__vset(&quad[3], bounds[0], bounds[1], 0.5f, 1.0f);
-        sgnvg__generateTriangleStripIndexes(&ctx->indexes[ioffset], offset, 4);
-
-        frag = linked_arena_alloc_clear(ctx->frame_arena, 2 * sizeof(*frag));
-        if (frag == NULL)
-            return;
-
-        call->uniforms = frag;
-
-        // Simple shader for stencil
-        frag->strokeThr = -1.0f;
-        frag->type      = NSVG_SHADER_SIMPLE;
-        // Fill shader
-        sgnvg__convertPaint(ctx, frag + 1, &paint, scissor, fringe, fringe, -1.0f);
-    }
-    else
-    {
-        frag = linked_arena_alloc_clear(ctx->frame_arena, sizeof(*frag));
-        if (frag == NULL)
-            return;
-        call->uniforms = frag;
-        // Fill shader
-        sgnvg__convertPaint(ctx, frag, &paint, scissor, fringe, fringe, -1.0f);
-    }
+        sgnvg__setBoundsQuad(ctx, call, offset, ioffset, bounds);
 
     sgnvg__addCall(ctx, call);
 
@@ -5129,24 +8015,17 @@ void nvgStroke(NVGcontext* ctx, float stroke_width)
 {
     NVGstate* state = &ctx->state;
 
-    if (ctx->ncommands == 0)
+    if (ctx->ncommands == 0 || (stroke_width > 0.0f && nvg__drawShape(ctx, stroke_width)))
         return;
 
-    float    scale             = nvg__getAverageScale(state->xform);
-    float    strokeWidth       = nvg__clampf(stroke_width * scale, 0.0f, 200.0f);
+    float    coverage          = 1.0f;
+    float    strokeWidth       = nvg__deviceStrokeWidth(ctx, stroke_width, &coverage);
     NVGpaint paint             = state->paint;
     float    expandFringeWidth = 0;
     int      i;
 
-    if (strokeWidth < ctx->fringeWidth)
-    {
-        // If the stroke width is less than pixel size, use alpha to emulate coverage.
-        // Since coverage is area, scale by alpha*alpha.
-        float alpha          = nvg__clampf(strokeWidth / ctx->fringeWidth, 0.0f, 1.0f);
-        paint.innerColour.a *= alpha * alpha;
-        paint.outerColour.a *= alpha * alpha;
-        strokeWidth          = ctx->fringeWidth;
-    }
+    paint.innerColour.a *= coverage;
+    paint.outerColour.a *= coverage;
 
     nvg__flattenPaths(ctx);
 
@@ -5155,14 +8034,12 @@ void nvgStroke(NVGcontext* ctx, float stroke_width)
     nvg__expandStroke(ctx, strokeWidth * 0.5f, expandFringeWidth, state->lineCap, state->lineJoin, state->miterLimit);
 
     NVGcompositeOperationState compositeOperation = state->compositeOperation;
-    NVGscissor*                scissor            = &state->scissor;
     float                      fringe             = ctx->fringeWidth;
     const NVGpath*             paths              = ctx->cache.paths;
     int                        npaths             = ctx->cache.npaths;
 
-    SGNVGcall*         call  = NULL;
-    SGNVGfragUniforms* frags = NULL;
-    int                maxverts, offset, maxindexes, ioffset;
+    SGNVGcall* call = NULL;
+    int        maxverts, offset, maxindexes, ioffset;
 
     // Looks like you forgot to call snvg_command_draw_nvg() before issuing nvgFill()/nvgStroke()/nvgText() commands!
     // NVG_ASSERT(ctx->current_nvg_draw != NULL); // TODO: remove?
@@ -5183,6 +8060,9 @@ void nvgStroke(NVGcontext* ctx, float stroke_width)
     call->smp       = paint.smp;
     call->blendFunc = sgnvg__blendCompositeOperation(compositeOperation);
 
+    // Setup uniforms for draw calls. Vertices are tagged with their index
+    sgnvg__setStrokeUniforms(ctx, call, &paint, strokeWidth, fringe);
+
     // Allocate vertices for all the paths.
     maxverts = sgnvg__maxVertCount(paths, npaths);
     offset   = sgnvg__allocVerts(ctx, maxverts);
@@ -5203,46 +8083,258 @@ void nvgStroke(NVGcontext* ctx, float stroke_width)
             // stroke: triangle strip
             copy->strokeOffset = ioffset;
             copy->strokeCount  = (path->nstroke - 2) * 3;
-            memcpy(&ctx->verts[offset], path->stroke, sizeof(NVGvertex) * path->nstroke);
+            sgnvg__copyVerts(&ctx->verts[offset], path->stroke, path->nstroke, call->uniformOffset);
             sgnvg__generateTriangleStripIndexes(&ctx->indexes[ioffset], offset, path->nstroke);
             offset  += path->nstroke;
             ioffset += copy->strokeCount;
         }
     }
 
-    if (ctx->flags & NVG_STENCIL_STROKES)
+    sgnvg__addCall(ctx, call);
+
+    // Count triangles
+    for (i = 0; i < ctx->cache.npaths; i++)
     {
-        // Fill shader
-        frags = linked_arena_alloc_clear(ctx->frame_arena, 2 * sizeof(*frags));
+        const NVGpath* path = &ctx->cache.paths[i];
 
-        if (frags == NULL)
-            return;
+        ctx->frame_stats.strokeTriCount += path->nstroke - 2;
+        ctx->frame_stats.drawCallCount++;
+    }
+}
+
+static NVGpathHandle* nvg__recordPaths(NVGcontext* ctx, enum SGNVGcallType type, float strokeWidth, float coverage)
+{
+    const NVGpath* paths  = ctx->cache.paths;
+    int            npaths = ctx->cache.npaths;
+    int            nverts = sgnvg__maxVertCount(paths, npaths);
+    float          inv[6];
+
+    if (!nvgTransformInverse(inv, ctx->state.xform))
+        return NULL;
+
+    // The handle, path layout & vertices share one allocation
+    size_t         size   = sizeof(NVGpathHandle) + sizeof(SGNVGpath) * npaths + sizeof(NVGvertex) * nverts;
+    NVGpathHandle* handle = NVG_MALLOC(size);
+    if (handle == NULL)
+        return NULL;
+    memset(handle, 0, sizeof(*handle));
+
+    handle->type        = type;
+    handle->strokeWidth = strokeWidth;
+    handle->coverage    = coverage;
+    handle->num_paths   = npaths;
+    handle->num_verts   = nverts;
+    handle->num_indexes = sgnvg__maxIndexCount(paths, npaths);
+    handle->paths       = (SGNVGpath*)(handle + 1);
+    handle->verts       = (NVGvertex*)(handle->paths + npaths);
+    memcpy(handle->inv_xform, inv, sizeof(inv));
+    memcpy(handle->bounds, ctx->cache.bounds, sizeof(handle->bounds));
+
+    int offset = 0;
+    for (int i = 0; i < npaths; i++)
+    {
+        SGNVGpath*     copy = &handle->paths[i];
+        const NVGpath* path = &paths[i];
+
+        memset(copy, 0, sizeof(*copy));
+        if (path->nfill > 0)
+        {
+            copy->fillOffset = offset;
+            copy->fillCount  = path->nfill;
+            memcpy(&handle->verts[offset], path->fill, sizeof(NVGvertex) * path->nfill);
+            offset += path->nfill;
+        }
+        if (path->nstroke > 0)
+        {
+            copy->strokeOffset = offset;
+            copy->strokeCount  = path->nstroke;
+            memcpy(&handle->verts[offset], path->stroke, sizeof(NVGvertex) * path->nstroke);
+            offset += path->nstroke;
+        }
+    }
+    NVG_ASSERT(offset == nverts);
+
+    return handle;
+}
+
+NVGpathHandle* nvgRecordFill(NVGcontext* ctx)
+{
+    NVGstate* state = &ctx->state;
+
+    if (ctx->ncommands == 0)
+        return NULL;
+
+    float expandFringeWidth = 0;
+
+    nvg__flattenPaths(ctx);
+    if (ctx->edgeAntiAlias && state->shapeAntiAlias)
+        expandFringeWidth = ctx->fringeWidth;
+
+    enum SGNVGcallType type = SGNVG_FILL;
+    if (ctx->cache.npaths == 1 && ctx->cache.paths[0].convex)
+        type = SGNVG_CONVEXFILL;
+    nvg__expandFill(ctx, expandFringeWidth, NVG_MITER, 2.4f, type == SGNVG_CONVEXFILL);
+
+    return nvg__recordPaths(ctx, type, 0, 1.0f);
+}
+
+NVGpathHandle* nvgRecordStroke(NVGcontext* ctx, float stroke_width)
+{
+    NVGstate* state = &ctx->state;
+
+    if (ctx->ncommands == 0)
+        return NULL;
+
+    float coverage          = 1.0f;
+    float strokeWidth       = nvg__deviceStrokeWidth(ctx, stroke_width, &coverage);
+    float expandFringeWidth = 0;
+
+    nvg__flattenPaths(ctx);
+    if (ctx->edgeAntiAlias && state->shapeAntiAlias)
+        expandFringeWidth = ctx->fringeWidth;
+    nvg__expandStroke(ctx, strokeWidth * 0.5f, expandFringeWidth, state->lineCap, state->lineJoin, state->miterLimit);
+
+    return nvg__recordPaths(ctx, SGNVG_STROKE, strokeWidth, coverage);
+}
+
+void nvgDestroyPathHandle(NVGcontext* ctx, NVGpathHandle* handle) { NVG_FREE(handle); }
+
+// Copies recorded vertices into the frame's vertices. Pure translations, the common case for icons & decorations
+// that move around, skip the matrix multiply
+static void sgnvg__transformVerts(SGNVGattribute* dst, const NVGvertex* src, int n, const float* t, int frag)
+{
+    const float eps       = 1e-5f;
+    const bool  translate = fabsf(t[0] - 1.0f) < eps && fabsf(t[1]) < eps && fabsf(t[2]) < eps &&
+                           fabsf(t[3] - 1.0f) < eps;
 
-        call->uniforms = frags;
+    if (translate)
+    {
+        for (int i = 0; i < n; i++)
+            sgnvg__vset(&dst[i], src[i].x + t[4], src[i].y + t[5], src[i].u, src[i].v, frag);
+    }
+    else
+    {
+        for (int i = 0; i < n; i++)
+        {
+            float x = src[i].x;
+            float y = src[i].y;
+            sgnvg__vset(&dst[i], x * t[0] + y * t[2] + t[4], x * t[1] + y * t[3] + t[5], src[i].u, src[i].v, frag);
+        }
+    }
+}
+
+void nvgDrawPathHandle(NVGcontext* ctx, const NVGpathHandle* handle)
+{
+    if (handle == NULL || handle->num_paths == 0)
+        return;
+
+    NVGstate*  state  = &ctx->state;
+    NVGpaint   paint  = state->paint;
+    float      fringe = ctx->fringeWidth;
+    SGNVGcall* call   = NULL;
+    int        maxverts, offset, maxindexes, ioffset, i;
+    float      t[6];
+
+    // Maps the device space the handle was recorded in onto the current one
+    memcpy(t, handle->inv_xform, sizeof(t));
+    nvgTransformMultiply(t, state->xform);
+
+    if (ctx->current_nvg_draw == NULL)
+        snvg_command_draw_nvg(ctx, NVG_LABEL("nvgDrawPathHandle"));
+
+    call = linked_arena_alloc_clear(ctx->frame_arena, sizeof(*call));
+    if (call == NULL)
+        return;
+
+    call->type          = handle->type;
+    call->triangleCount = handle->type == SGNVG_FILL ? 4 : 0;
+    call->paths         = linked_arena_alloc_clear(ctx->frame_arena, handle->num_paths * sizeof(*call->paths));
+    if (call->paths == NULL)
+        return;
+    call->num_paths = handle->num_paths;
+    call->texview   = paint.texview;
+    call->smp       = paint.smp;
+    call->blendFunc = sgnvg__blendCompositeOperation(state->compositeOperation);
 
-        sgnvg__convertPaint(ctx, call->uniforms, &paint, scissor, strokeWidth, fringe, -1.0f);
-        sgnvg__convertPaint(ctx, call->uniforms + 1, &paint, scissor, strokeWidth, fringe, 1.0f - 0.5f / 255.0f);
+    if (handle->type == SGNVG_STROKE)
+    {
+        float strokeWidth    = handle->strokeWidth * nvg__getAverageScale(t);
+        paint.innerColour.a *= handle->coverage;
+        paint.outerColour.a *= handle->coverage;
+        sgnvg__setStrokeUniforms(ctx, call, &paint, strokeWidth, fringe);
     }
     else
     {
-        // Fill shader
-        frags = linked_arena_alloc_clear(ctx->frame_arena, sizeof(*frags));
-        if (frags == NULL)
-            return;
-        call->uniforms = frags;
-        sgnvg__convertPaint(ctx, call->uniforms, &paint, scissor, strokeWidth, fringe, -1.0f);
+        sgnvg__setFillUniforms(ctx, call, &paint, fringe);
     }
 
-    sgnvg__addCall(ctx, call);
+    maxverts = handle->num_verts + call->triangleCount;
+    offset   = sgnvg__allocVerts(ctx, maxverts);
+    if (offset == -1)
+        return;
+    maxindexes = handle->num_indexes + nvg__maxi(call->triangleCount - 2, 0) * 3;
+    ioffset    = sgnvg__allocIndexes(ctx, maxindexes);
+    if (ioffset == -1)
+        return;
 
-    // Count triangles
-    for (i = 0; i < ctx->cache.npaths; i++)
+    sgnvg__transformVerts(&ctx->verts[offset], handle->verts, handle->num_verts, t, call->uniformOffset);
+
+    for (i = 0; i < handle->num_paths; i++)
     {
-        const NVGpath* path = &ctx->cache.paths[i];
+        const SGNVGpath* path = &handle->paths[i];
+        SGNVGpath*       copy = &call->paths[i];
 
-        ctx->frame_stats.strokeTriCount += path->nstroke - 2;
-        ctx->frame_stats.drawCallCount++;
+        if (path->fillCount > 0)
+        {
+            // fill: triangle fan
+            copy->fillOffset = ioffset;
+            copy->fillCount  = (path->fillCount - 2) * 3;
+            sgnvg__generateTriangleFanIndexes(&ctx->indexes[ioffset], offset + path->fillOffset, path->fillCount);
+            ioffset += copy->fillCount;
+
+            ctx->frame_stats.fillTriCount += path->fillCount - 2;
+        }
+        if (path->strokeCount > 0)
+        {
+            // stroke: triangle strip
+            copy->strokeOffset = ioffset;
+            copy->strokeCount  = (path->strokeCount - 2) * 3;
+            sgnvg__generateTriangleStripIndexes(
+                &ctx->indexes[ioffset],
+                offset + path->strokeOffset,
+                path->strokeCount);
+            ioffset += copy->strokeCount;
+
+            if (handle->type == SGNVG_STROKE)
+                ctx->frame_stats.strokeTriCount += path->strokeCount - 2;
+            else
+                ctx->frame_stats.fillTriCount += path->strokeCount - 2;
+        }
+        ctx->frame_stats.drawCallCount += handle->type == SGNVG_STROKE ? 1 : 2;
+    }
+
+    if (handle->type == SGNVG_FILL)
+    {
+        // Bounds of the transformed corners
+        const float* b = handle->bounds;
+        float        corners[8], bounds[4];
+        nvgTransformPoint(&corners[0], &corners[1], t, b[0], b[1]);
+        nvgTransformPoint(&corners[2], &corners[3], t, b[2], b[1]);
+        nvgTransformPoint(&corners[4], &corners[5], t, b[2], b[3]);
+        nvgTransformPoint(&corners[6], &corners[7], t, b[0], b[3]);
+        bounds[0] = bounds[2] = corners[0];
+        bounds[1] = bounds[3] = corners[1];
+        for (int k = 2; k < 8; k += 2)
+        {
+            bounds[0] = nvg__minf(bounds[0], corners[k]);
+            bounds[1] = nvg__minf(bounds[1], corners[k + 1]);
+            bounds[2] = nvg__maxf(bounds[2], corners[k]);
+            bounds[3] = nvg__maxf(bounds[3], corners[k + 1]);
+        }
+        sgnvg__setBoundsQuad(ctx, call, offset + handle->num_verts, ioffset, bounds);
     }
+
+    sgnvg__addCall(ctx, call);
 }
 
 // Source: https://github.com/floooh/sokol/issues/102
@@ -5736,6 +8828,158 @@ void snvg_command_draw_nvg(NVGcontext* ctx, const char* label)
     ctx->current_nvg_draw = draws;
 }
 
+void snvg_command_draw_list(NVGcontext* ctx, const NVGdisplayList* list, const char* label)
+{
+    NVG_ASSERT(list != NULL);
+    SGNVGcommand* cmd = sgnvg__allocCommand(ctx, SGNVG_CMD_DRAW_LIST, label);
+
+    cmd->payload.list = list;
+}
+
+void nvgBeginDisplayList(NVGcontext* ctx)
+{
+    NVG_ASSERT(!ctx->list_recording.active);
+
+    ctx->list_recording.active        = true;
+    ctx->list_recording.draws         = (SGNVGcommandNVG){0};
+    ctx->list_recording.prev_call     = ctx->current_call;
+    ctx->list_recording.prev_nvg_draw = ctx->current_nvg_draw;
+    ctx->list_recording.vert_start    = ctx->nverts;
+    ctx->list_recording.index_start   = ctx->nindexes;
+    ctx->list_recording.uniform_start = xarr_len(ctx->frag_uniforms);
+
+    ctx->current_call     = NULL;
+    ctx->current_nvg_draw = &ctx->list_recording.draws;
+}
+
+// Drops the recorded geometry & uniforms from the frame, so nothing recorded is drawn this frame
+static void nvg__stopListRecording(NVGcontext* ctx)
+{
+    xarr_setlen(ctx->frag_uniforms, ctx->list_recording.uniform_start);
+    ctx->nverts           = ctx->list_recording.vert_start;
+    ctx->nindexes         = ctx->list_recording.index_start;
+    ctx->current_call     = ctx->list_recording.prev_call;
+    ctx->current_nvg_draw = ctx->list_recording.prev_nvg_draw;
+    memset(&ctx->list_recording, 0, sizeof(ctx->list_recording));
+}
+
+NVGdisplayList* nvgEndDisplayList(NVGcontext* ctx, const char* label)
+{
+    NVG_ASSERT(ctx->list_recording.active);
+    NVG_ASSERT(ctx->current_nvg_draw == &ctx->list_recording.draws);
+
+    const int vert_start    = ctx->list_recording.vert_start;
+    const int index_start   = ctx->list_recording.index_start;
+    const int uniform_start = ctx->list_recording.uniform_start;
+    const int nverts        = ctx->nverts - vert_start;
+    const int nindexes      = ctx->nindexes - index_start;
+    const int nuniforms     = xarr_len(ctx->frag_uniforms) - uniform_start;
+
+    NVGdisplayList* list = NVG_MALLOC(sizeof(*list));
+    NVG_ASSERT_GOTO(list != NULL, error);
+    memset(list, 0, sizeof(*list));
+    list->arena = linked_arena_create(1024 * 4);
+    NVG_ASSERT_GOTO(list->arena != NULL, error);
+
+    // Copy the calls out of the frame arena, with offsets relative to the list's own buffers
+    SGNVGcall*       prev = NULL;
+    const SGNVGcall* src  = nverts > 0 && nindexes > 0 ? ctx->list_recording.draws.calls : NULL;
+    for (; src != NULL; src = src->next)
+    {
+        SGNVGcall* call = linked_arena_alloc(list->arena, sizeof(*call));
+        NVG_ASSERT_GOTO(call != NULL, error);
+
+        *call                = *src;
+        call->next           = NULL;
+        call->uniformOffset -= uniform_start;
+        if (call->triangleCount > 0)
+            call->triangleOffset -= index_start;
+
+        call->paths = linked_arena_alloc(list->arena, sizeof(*call->paths) * nvg__maxi(call->num_paths, 1));
+        NVG_ASSERT_GOTO(call->paths != NULL, error);
+        for (int i = 0; i < call->num_paths; i++)
+        {
+            SGNVGpath* path = &call->paths[i];
+            *path           = src->paths[i];
+            if (path->fillCount > 0)
+                path->fillOffset -= index_start;
+            if (path->strokeCount > 0)
+                path->strokeOffset -= index_start;
+        }
+
+        if (prev)
+            prev->next = call;
+        else
+            list->draws.calls = call;
+        prev = call;
+        list->draws.num_calls++;
+    }
+
+    if (list->draws.num_calls > 0)
+    {
+        SGNVGattribute*    verts    = &ctx->verts[vert_start];
+        uint32_t*          indexes  = &ctx->indexes[index_start];
+        SGNVGfragUniforms* uniforms = &ctx->frag_uniforms[uniform_start];
+        for (int i = 0; i < nverts; i++)
+            verts[i].frag -= uniform_start;
+        for (int i = 0; i < nindexes; i++)
+            indexes[i] -= vert_start;
+
+        list->vertBuf = sg_make_buffer(&(sg_buffer_desc){
+            .usage.vertex_buffer = true,
+            .usage.immutable     = true,
+            .data                = (sg_range){verts, nverts * sizeof(*verts)},
+            .label               = label,
+        });
+        list->indexBuf = sg_make_buffer(&(sg_buffer_desc){
+            .usage.index_buffer = true,
+            .usage.immutable    = true,
+            .data               = (sg_range){indexes, nindexes * sizeof(*indexes)},
+            .label              = label,
+        });
+        list->fragBuf = sg_make_buffer(&(sg_buffer_desc){
+            .usage.storage_buffer = true,
+            .usage.immutable      = true,
+            .data                 = (sg_range){uniforms, nuniforms * sizeof(*uniforms)},
+            .label                = label,
+        });
+        list->fragView = sg_make_view(&(sg_view_desc){
+            .storage_buffer = list->fragBuf,
+        });
+        ctx->frame_stats.uploaded_bytes +=
+            nverts * sizeof(*verts) + nindexes * sizeof(*indexes) + nuniforms * sizeof(*uniforms);
+    }
+
+    nvg__stopListRecording(ctx);
+    return list;
+
+error:
+    if (list != NULL)
+    {
+        if (list->arena != NULL)
+            linked_arena_destroy(list->arena);
+        NVG_FREE(list);
+    }
+    nvg__stopListRecording(ctx);
+    return NULL;
+}
+
+void nvgDestroyDisplayList(NVGcontext* ctx, NVGdisplayList* list)
+{
+    if (list == NULL)
+        return;
+    if (list->vertBuf.id)
+        sg_destroy_buffer(list->vertBuf);
+    if (list->indexBuf.id)
+        sg_destroy_buffer(list->indexBuf);
+    if (list->fragView.id)
+        sg_destroy_view(list->fragView);
+    if (list->fragBuf.id)
+        sg_destroy_buffer(list->fragBuf);
+    linked_arena_destroy(list->arena);
+    NVG_FREE(list);
+}
+
 void snvg_command_fx(
     NVGcontext*       ctx,
     bool              apply_lightness_filter,
@@ -5788,11 +9032,23 @@ NVGcontext* nvgCreateContext(int flags)
     ctx->frame_arena = linked_arena_create(1024 * 64);
     NVG_ASSERT_GOTO(ctx->frame_arena != NULL, error);
 
+#ifdef NVG_FONT_FREETYPE_SDF
+    // SDF glyphs are scaled when drawn, so phases in raster pixels don't line up with layout pixels
+    flags &= ~NVG_SUBPIXEL_GLYPHS;
+#endif
     ctx->edgeAntiAlias = flags & NVG_ANTIALIAS ? 1 : 0;
     ctx->flags         = flags;
 
+    for (int i = 0; i < NVG_MAX_CIRCLE_SEGMENTS; i++)
+    {
+        float a                     = i * (NVG_PI * 2 / NVG_MAX_CIRCLE_SEGMENTS);
+        ctx->unit_circle[i * 2]     = nvg__cosf(a);
+        ctx->unit_circle[i * 2 + 1] = nvg__sinf(a);
+    }
+
     // if(ctx->flags & NVG_ANTIALIAS)
-    ctx->shader = sg_make_shader(nanovg_sg_shader_desc(sg_query_backend()));
+    ctx->shader       = sg_make_shader(nanovg_sg_shader_desc(sg_query_backend()));
+    ctx->shape_shader = sg_make_shader(nanovg_shape_shader_desc(sg_query_backend()));
     // else
     // ctx->shader = sg_make_shader(nanovg_sg_shader_desc(sg_query_backend()));
     for (int i = 0; i < NANOVG_SG_PIPELINE_CACHE_SIZE; i++)
@@ -5905,25 +9161,28 @@ NVGcontext* nvgCreateContext(int flags)
     ctx->kbts = kbts_CreateShapeContext(0, 0);
 
 #ifdef NVG_FONT_FREETYPE
-    int err = FT_Init_FreeType(&ctx->ft_lib);
+    int err = nvg__initFreeType(&ctx->ft_lib);
     xassert(!err);
 #endif
 
     xarr_setcap(ctx->rects, 64);
-    ctx->text_sbo = sg_make_buffer(&(sg_buffer_desc){
-        .usage.storage_buffer = true,
-        .usage.stream_update  = true,
-        .size                 = sizeof(ctx->text_buffer),
-        .label                = "text SBO",
-    });
-    xassert(ctx->text_sbo.id);
-    ctx->text_sbv = sg_make_view(&(sg_view_desc){
-        .storage_buffer = ctx->text_sbo,
-    });
-    xassert(ctx->text_sbv.id);
+    nvg__glyphIndexRebuild(ctx, 128);
+
+    ctx->layout_cache.arenas[0] = linked_arena_create(1024 * 64);
+    ctx->layout_cache.arenas[1] = linked_arena_create(1024 * 64);
+    NVG_ASSERT_GOTO(ctx->layout_cache.arenas[0] != NULL && ctx->layout_cache.arenas[1] != NULL, error);
+    nvg__layoutCacheRebuild(ctx, 64);
+    xarr_setcap(ctx->text_buffer, NVG_INIT_TEXT_SBO_SIZE);
+    nvg__makeTextSBO(ctx, NVG_INIT_TEXT_SBO_SIZE);
+    xarr_setcap(ctx->frag_uniforms, NVG_INIT_FRAG_SBO_SIZE);
+    sgnvg__makeFragSBO(ctx, NVG_INIT_FRAG_SBO_SIZE);
+    xarr_setcap(ctx->shapes, NVG_INIT_SHAPE_SBO_SIZE);
+    sgnvg__makeShapeSBO(ctx, NVG_INIT_SHAPE_SBO_SIZE);
 
 #if defined(NVG_FONT_FREETYPE_MULTICHANNEL)
     sg_shader text_shd = sg_make_shader(text_multichannel_shader_desc(sg_query_backend()));
+#elif defined(NVG_FONT_FREETYPE_SDF)
+    sg_shader text_shd = sg_make_shader(text_sdf_shader_desc(sg_query_backend()));
 #else
     sg_shader text_shd = sg_make_shader(text_singlechannel_shader_desc(sg_query_backend()));
 #endif
@@ -5939,7 +9198,7 @@ NVGcontext* nvgCreateContext(int flags)
                  .src_factor_rgb = SG_BLENDFACTOR_ONE, // use if premultiplied alpha
                  .dst_factor_rgb = SG_BLENDFACTOR_ONE_MINUS_SRC1_COLOR,
         }};
-#elif defined(NVG_FONT_FREETYPE_SINGLECHANNEL)
+#elif defined(NVG_FONT_FREETYPE_SINGLECHANNEL) || defined(NVG_FONT_FREETYPE_SDF)
     pip_desc.colors[0] = (sg_color_target_state){
         .write_mask = SG_COLORMASK_RGBA,
         .blend      = {
@@ -5953,8 +9212,16 @@ NVGcontext* nvgCreateContext(int flags)
 
     ctx->text_pip = sg_make_pipeline(&pip_desc);
 
+    ctx->atlas_upload.shd = sg_make_shader(atlas_copy_shader_desc(sg_query_backend()));
+    ctx->atlas_upload.pip = sg_make_pipeline(&(sg_pipeline_desc){
+        .shader                 = ctx->atlas_upload.shd,
+        .depth                  = {.pixel_format = SG_PIXELFORMAT_NONE},
+        .colors[0].pixel_format = NVG_SG_PIXEL_FORMAT,
+        .label                  = "atlas-copy-pipeline"});
+
     ctx->current_atlas.idx = 0;
-    xarr_setcap(ctx->glyph_atlases, 16);
+    _Static_assert(NVG_MAX_GLYPH_ATLASES > 1 && NVG_MAX_GLYPH_ATLASES < NVG_GLYPH_PENDING, "atlas_idx is a uint8_t");
+    xarr_setcap(ctx->glyph_atlases, NVG_MAX_GLYPH_ATLASES);
     xarr_setlen(ctx->glyph_atlases, 1);
     ctx->glyph_atlases[0] = glyph_atlas_new();
 
@@ -5969,6 +9236,11 @@ NVGcontext* nvgCreateContext(int flags)
         ctx->current_atlas.nodes,
         xarr_len(ctx->current_atlas.nodes));
 
+#ifdef NVG_FONT_FREETYPE
+    if (ctx->flags & NVG_ASYNC_GLYPHS)
+        ctx->glyph_worker = nvg__glyphWorkerCreate(ctx);
+#endif
+
     return ctx;
 
 error:
@@ -5986,6 +9258,13 @@ void nvgDestroyContext(NVGcontext* ctx)
     NVG_FREE(ctx->cache.points);
     NVG_FREE(ctx->cache.paths);
     NVG_FREE(ctx->cache.verts);
+    NVG_FREE(ctx->cache.tris);
+
+#ifdef NVG_FONT_FREETYPE
+    // Join before the fonts are freed. The worker reads their data
+    if (ctx->glyph_worker)
+        nvg__glyphWorkerDestroy(ctx->glyph_worker);
+#endif
 
     // if (ctx->fs)
     // fonsDeleteInternal(ctx->fs);
@@ -6001,20 +9280,58 @@ void nvgDestroyContext(NVGcontext* ctx)
     NVG_FREE(ctx->current_atlas.img_data);
     xarr_free(ctx->current_atlas.nodes);
     xarr_free(ctx->rects);
+    xarr_free(ctx->glyph_batch.glyphs);
+    xarr_free(ctx->glyph_batch.staging);
+    xarr_free(ctx->glyph_batch.rects);
+    xarr_free(ctx->text_buffer);
+    xarr_free(ctx->frag_uniforms);
+    xarr_free(ctx->shapes);
+    NVG_FREE(ctx->rects_index);
+    NVG_FREE(ctx->layout_cache.entries);
+    for (int i = 0; i < NVG_ARRLEN(ctx->layout_cache.arenas); i++)
+        if (ctx->layout_cache.arenas[i])
+            linked_arena_destroy(ctx->layout_cache.arenas[i]);
+    for (int i = 0; i < xarr_len(ctx->glyph_atlases); i++)
+    {
+        NVGatlas* atlas = ctx->glyph_atlases + i;
+        sg_destroy_view(atlas->img_view);
+        sg_destroy_view(atlas->att_view);
+        sg_destroy_image(atlas->img);
+        if (atlas->img_data)
+            NVG_FREE(atlas->img_data);
+    }
     xarr_free(ctx->glyph_atlases);
+    nvg__trimAtlasStaging(ctx, 0);
+    sg_destroy_pipeline(ctx->atlas_upload.pip);
+    sg_destroy_shader(ctx->atlas_upload.shd);
+    xarr_free(ctx->atlas_upload.staging);
+    xarr_free(ctx->atlas_upload.staging_views);
+    xarr_free(ctx->atlas_upload.copies);
     for (int i = 0; i < NVG_ARRLEN(ctx->fonts); i++)
     {
         NVGfontSlot* sl = ctx->fonts + i;
         if (sl->kbtr_font_ptr)
         {
+#ifdef NVG_FONT_FREETYPE
+            if (sl->ft_face)
+                FT_Done_Face(sl->ft_face);
+#endif
             if (sl->owned)
             {
                 XFILES_FREE(sl->data);
             }
         }
     }
+#ifdef NVG_FONT_FREETYPE
+    FT_Done_FreeType(ctx->ft_lib);
+#endif
 
     sg_destroy_shader(ctx->shader);
+    sg_destroy_view(ctx->frag_sbv);
+    sg_destroy_buffer(ctx->frag_sbo);
+    sg_destroy_shader(ctx->shape_shader);
+    sg_destroy_view(ctx->shape_sbv);
+    sg_destroy_buffer(ctx->shape_sbo);
 
     for (int i = 0; i < NANOVG_SG_PIPELINE_CACHE_SIZE; i++)
     {
@@ -186,7 +186,7 @@ extern "C" {
 #define NVG_ARRLEN(arr) (sizeof(arr) / sizeof(0 [arr]))
 
 #if !defined(NVG_FONT_STB_TRUETYPE) && !defined(NVG_FONT_FREETYPE_SINGLECHANNEL) &&                                    \
-    !defined(NVG_FONT_FREETYPE_MULTICHANNEL)
+    !defined(NVG_FONT_FREETYPE_MULTICHANNEL) && !defined(NVG_FONT_FREETYPE_SDF)
 // #define NVG_FONT_STB_TRUETYPE
 #ifdef __APPLE__
 #define NVG_FONT_FREETYPE_SINGLECHANNEL
@@ -195,7 +195,10 @@ extern "C" {
 #endif
 
 #endif
-#if defined(NVG_FONT_FREETYPE_SINGLECHANNEL) || defined(NVG_FONT_FREETYPE_MULTICHANNEL)
+// NVG_FONT_FREETYPE_SDF rasters signed distance fields at a single size, so one cached glyph serves every font size.
+// Best suited to zoomable UIs & animated text. Small text is softer than the hinted bitmap modes
+#if defined(NVG_FONT_FREETYPE_SINGLECHANNEL) || defined(NVG_FONT_FREETYPE_MULTICHANNEL) ||                             \
+    defined(NVG_FONT_FREETYPE_SDF)
 #define NVG_FONT_FREETYPE
 #endif
 
@@ -391,6 +394,7 @@ typedef struct NVGpath
     int           nstroke;
     int           winding;
     int           convex;
+    unsigned char triangulate_failed; // NVG_TRIANGULATE_CONCAVE couldn't ear clip the outline
 } NVGpath;
 
 enum NVGcommands
@@ -400,8 +404,29 @@ enum NVGcommands
     NVG_BEZIERTO = 2,
     NVG_CLOSE    = 3,
     NVG_WINDING  = 4,
+    NVG_SMOOTHTO = 5, // Same as NVG_LINETO, but the point is on a smooth curve, not a corner
 };
 
+// Segments in the most detailed unit circle. Arcs, circles & rounded rects take every Nth point, picking the LOD from
+// their on-screen radius. Must be a power of 2
+#ifndef NVG_MAX_CIRCLE_SEGMENTS
+#define NVG_MAX_CIRCLE_SEGMENTS 512
+#endif
+
+// Frames the streamed vertex & index buffers must stay under a quarter full before they shrink to half their size
+#ifndef NVG_STREAM_SHRINK_FRAMES
+#define NVG_STREAM_SHRINK_FRAMES 300
+#endif
+
+// Longest outline NVG_TRIANGULATE_CONCAVE ear clips. Ear clipping is O(n^2), longer outlines use the stencil buffer
+#ifndef NVG_MAX_TRIANGULATE_VERTS
+#define NVG_MAX_TRIANGULATE_VERTS 128
+#endif
+// Outlines NVG_TRIANGULATE_CONCAVE failed to ear clip are remembered by hash, so they aren't attempted every frame
+#ifndef NVG_TRIANGULATE_FAILURES
+#define NVG_TRIANGULATE_FAILURES 16
+#endif
+
 enum NVGpointFlags
 {
     NVG_PT_CORNER     = 0x01,
@@ -449,6 +474,8 @@ typedef struct NVGpathCache
     NVGvertex* verts;
     int        nverts;
     int        cverts;
+    int*       tris; // Ear clipped triangles of the last concave fill, followed by scratch space
+    int        ctris;
     float      bounds[4];
 } NVGpathCache;
 
@@ -463,6 +490,20 @@ enum NVGcreateFlags
     NVG_STENCIL_STROKES = 1 << 1,
     // Flag indicating that additional debug checks are done.
     NVG_DEBUG = 1 << 2,
+    // Flag indicating glyphs are rastered on a background thread. Glyphs are laid out immediately using their metrics,
+    // but are invisible until their bitmaps land in an atlas, usually by the next frame.
+    NVG_ASYNC_GLYPHS = 1 << 3,
+    // Flag indicating a CPU copy of every full glyph atlas page is kept, so they can be written with
+    // nvgSaveGlyphCache(). Without it, only the page currently being packed is saved.
+    NVG_GLYPH_CACHE_PIXELS = 1 << 4,
+    // Flag indicating glyphs are positioned to the nearest 1/NVG_GLYPH_SUBPIXEL_PHASES of a pixel within a layout, rather
+    // than snapped to whole pixels. Smoother spacing & animation at the cost of more atlas space.
+    NVG_SUBPIXEL_GLYPHS = 1 << 5,
+    // Flag indicating concave fills made of a single outline are triangulated on the CPU & drawn like convex fills,
+    // instead of with the stencil buffer. Outlines with holes or self-intersections still use the stencil buffer.
+    // Costs O(n^2) CPU time per fill for outlines of up to NVG_MAX_TRIANGULATE_VERTS vertices. Worth it when the
+    // stencil passes cost more than the CPU time, eg. small concave icons on tiled GPUs.
+    NVG_TRIANGULATE_CONCAVE = 1 << 6,
 };
 
 enum SGNVGshaderType
@@ -473,14 +514,29 @@ enum SGNVGshaderType
     NSVG_SHADER_IMG
 };
 
+#ifndef NVG_MAX_DIRTY_RECTS
+#define NVG_MAX_DIRTY_RECTS 4
+#endif
+// Regions of a texture modified on the CPU since its last upload.
+// Touching regions are merged. Once full, new regions are merged into whichever region grows the least
+typedef struct NVGdirtyRects
+{
+    int num;
+    struct
+    {
+        int x0, y0, x1, y1;
+    } rects[NVG_MAX_DIRTY_RECTS];
+} NVGdirtyRects;
+
 typedef struct SGNVGtexture
 {
-    sg_image img;
-    sg_view  texview;
-    int      type;
-    int      width, height;
-    int      flags;
-    uint8_t* imgData;
+    sg_image      img;
+    sg_view       texview;
+    int           type;
+    int           width, height;
+    int           flags;
+    uint8_t*      imgData;
+    NVGdirtyRects dirty; // Empty while NVG_IMAGE_DIRTY is set means the whole image
 } SGNVGtexture;
 
 typedef struct SGNVGframebuffer
@@ -521,6 +577,7 @@ enum SGNVGcallType
     SGNVG_CONVEXFILL,
     SGNVG_STROKE,
     SGNVG_TRIANGLES,
+    SGNVG_SHAPES, // Run of SGNVGshape drawn by the SDF shader, see nvg__drawShape()
 };
 
 typedef struct SGNVGpath
@@ -535,11 +592,13 @@ typedef struct SGNVGattribute
 {
     float vertex[2];
     float tcoord[2];
+    float frag; // Index of the call's uniforms in the frame's uniforms storage buffer. See SGNVGcall.uniformOffset
 } SGNVGattribute;
 
 typedef struct SGNVGvertUniforms
 {
     float viewSize[4];
+    float fragOffset[4]; // x: which of the call's uniforms to use, 0 or 1
 } SGNVGvertUniforms;
 
 typedef struct SGNVGfragUniforms
@@ -567,8 +626,21 @@ typedef struct SGNVGfragUniforms
     };
 } SGNVGfragUniforms;
 
-// LRU cache; keep its size relatively small, as items are accessed via a linear search
+// Rect, rounded rect or circle drawn from its signed distance instead of tessellated. See shape in nanovg_sokol.glsl
+typedef struct SGNVGshape
+{
+    float rect[4];    // x, y, w, h in device pixels
+    float radii[4];   // top left, top right, bottom right, bottom left
+    float halfStroke; // 0 for fills
+    float frag;       // Index into NVGcontext.frag_uniforms
+    float fringe;     // 0 without antialiasing
+    float roundJoin;  // 1 if square corners get round stroke joins
+} SGNVGshape;
+
+// LRU cache, found through a hash of the blend. Evicting a blend drops all of its pipelines, see nvgWarmPipelines()
 #define NANOVG_SG_PIPELINE_CACHE_SIZE 32
+// Power of 2. Twice the cache size keeps the table at most half full
+#define NANOVG_SG_PIPELINE_HASH_SIZE (NANOVG_SG_PIPELINE_CACHE_SIZE * 2)
 
 typedef struct SGNVGpipelineCacheKey
 {
@@ -592,6 +664,9 @@ enum SGNVGpipelineType
     SGNVG_PIP_STROKE_STENCIL_ANTIALIAS, // only used if sg->flags & NVG_STENCIL_STROKES
     SGNVG_PIP_STROKE_STENCIL_CLEAR,     // only used if sg->flags & NVG_STENCIL_STROKES
 
+    // used by sgnvg__shapes
+    SGNVG_PIP_SHAPES,
+
     SGNVG_PIP_NUM_
 };
 
@@ -602,6 +677,8 @@ typedef struct SGNVGpipelineCache
     sg_pipeline           pipelines[NANOVG_SG_PIPELINE_CACHE_SIZE][SGNVG_PIP_NUM_];
     uint8_t               pipelinesActive[NANOVG_SG_PIPELINE_CACHE_SIZE];
     uint32_t              currentUse; // incremented on each overwrite
+    // Open addressing hash of keys[].blend, rebuilt on eviction. Holds the key's index + 1, 0 when empty
+    uint8_t               table[NANOVG_SG_PIPELINE_HASH_SIZE];
 } SGNVGpipelineCache;
 
 typedef struct SGNVGcall
@@ -617,12 +694,34 @@ typedef struct SGNVGcall
     int        num_paths;
     SGNVGpath* paths;
 
-    // depending on SGNVGcall.type and NVG_STENCIL_STROKES, this may be 2 consecutive uniforms
-    SGNVGfragUniforms* uniforms;
+    // Index into NVGcontext.frag_uniforms. Depending on SGNVGcall.type and NVG_STENCIL_STROKES, this may be 2
+    // consecutive uniforms
+    int uniformOffset;
+
+    // SGNVG_SHAPES only. Range of NVGcontext.shapes
+    int shapeOffset;
+    int shapeCount;
 
     struct SGNVGcall* next;
 } SGNVGcall;
 
+// Tessellated fill or stroke kept across frames, so static shapes skip flattening & expansion. Vertices are in the
+// device space the path was recorded in; drawing maps them through the current transform. Path offsets & counts are
+// in vertices, relative to verts
+typedef struct NVGpathHandle
+{
+    enum SGNVGcallType type; // SGNVG_FILL, SGNVG_CONVEXFILL or SGNVG_STROKE
+    float              inv_xform[6];
+    float              bounds[4];
+    float              strokeWidth; // device pixels, at the recorded transform
+    float              coverage;    // alpha for strokes thinner than a pixel
+    int                num_paths;
+    int                num_verts;
+    int                num_indexes;
+    SGNVGpath*         paths;
+    NVGvertex*         verts;
+} NVGpathHandle;
+
 typedef struct SGNVGcommandBeginPass
 {
     sg_pass  pass;
@@ -634,15 +733,29 @@ typedef struct SGNVGcommandNVG
 {
     int               num_calls;
     struct SGNVGcall* calls;
+    // Frame vertices & indexes used up to & including this draw. Appended to the GPU buffers before it's drawn
+    int vert_end;
+    int index_end;
 } SGNVGcommandNVG;
 
+// nvg calls baked into immutable GPU buffers, so replaying them costs no tessellation & no upload.
+// See nvgBeginDisplayList()
+typedef struct NVGdisplayList
+{
+    LinkedArena*    arena; // calls & paths
+    SGNVGcommandNVG draws;
+    sg_buffer       vertBuf;
+    sg_buffer       indexBuf;
+    sg_buffer       fragBuf; // The calls' uniforms
+    sg_view         fragView;
+} NVGdisplayList;
+
 typedef struct SGNVGcommandText
 {
-    int text_buffer_start;
-    int text_buffer_end;
-    // TODO: support more colours
-    NVGcolour colour_fill;
-    sg_view   atlas_view;
+    int     text_buffer_start;
+    int     text_buffer_end;
+    sg_view atlas_view; // Glyph colours are stored per glyph in the text buffer
+    float   glyph_scale; // See NVGtextLayout.glyph_scale
 } SGNVGcommandText;
 
 typedef struct SGNVGcommandImageFX
@@ -673,6 +786,7 @@ enum SGNVGcommandType
     SGNVG_CMD_END_PASS,
     SGNVG_CMD_DRAW_NVG,
     SGNVG_CMD_DRAW_TEXT,
+    SGNVG_CMD_DRAW_LIST,
     SGNVG_CMD_IMAGE_FX,
     SGNVG_CMD_CUSTOM,
 };
@@ -688,6 +802,7 @@ typedef struct SGNVGcommand
         SGNVGcommandBeginPass* beginPass;
         SGNVGcommandNVG*       drawNVG;
         SGNVGcommandText*      text;
+        const NVGdisplayList*  list;
         SGNVGcommandImageFX*   fx;
         SGNVGcommandCustom*    custom;
     } payload;
@@ -695,24 +810,69 @@ typedef struct SGNVGcommand
     struct SGNVGcommand* next;
 } SGNVGcommand;
 
+#ifdef NVG_FONT_FREETYPE
+// An FT_Size object for one pixel size of a font, with its scaled metrics
+typedef struct NVGfontSize
+{
+    struct FT_SizeRec_* ft_size;
+    uint32_t            pixel_size; // 0 marks an empty slot
+    uint32_t            last_used_frame;
+
+    // Copied from FT_Size_Metrics
+    int32_t ascender;  // 26.6
+    int32_t descender; // 26.6
+    int32_t height;    // 26.6
+    int32_t x_scale;   // 16.16
+    int32_t y_scale;   // 16.16
+} NVGfontSize;
+#endif
+
 typedef struct NVGfontSlot
 {
     void*  kbtr_font_ptr;
     void*  data;
     size_t data_size;
     int    owned;
+    int    face_index;
+#ifdef NVG_FONT_FREETYPE
+    struct FT_FaceRec_* ft_face;
+    bool                has_ascii; // Has a glyph for every printable ASCII character
+
+#ifndef NVG_MAX_FONT_SIZES
+#define NVG_MAX_FONT_SIZES 8
+#endif
+    // Switching between cached sizes is only a pointer swap. The least recently used size is recycled when full
+    NVGfontSize sizes[NVG_MAX_FONT_SIZES];
+#endif
 } NVGfontSlot;
 
+// Font sizes are stored in the glyph header as fixed point. To support sizes like 12.25, multiply & divide by 4
+#define NVG_GLYPH_FONT_SIZE_SHIFT 2
+
+// Number of horizontal subpixel positions glyphs are rastered at with NVG_SUBPIXEL_GLYPHS. Each phase is a separate
+// glyph in the atlas, so atlas usage grows up to this many times
+#ifndef NVG_GLYPH_SUBPIXEL_PHASES
+#define NVG_GLYPH_SUBPIXEL_PHASES 4
+#endif
+
+// With NVG_FONT_FREETYPE_SDF, every glyph is rastered at this pixel size and scaled when drawn
+#ifndef NVG_SDF_GLYPH_SIZE
+#define NVG_SDF_GLYPH_SIZE 32
+#endif
+// Distance in pixels either side of the outline stored in SDF glyphs. Also pads each glyph's bitmap
+#ifndef NVG_SDF_SPREAD
+#define NVG_SDF_SPREAD 4
+#endif
+
 // Used to identify a unique glyph.
-// TODO: support multiple fonts
 typedef union NVGatlasRectHeader
 {
     struct
     {
         uint32_t glyph_index;
-        // TODO: this could probably be packed into an integer. To support sizes like 12.25, multiply & divide by 4
-        // This could make room for font ids in the header
-        float font_size;
+        uint16_t font_size; // fixed point, see NVG_GLYPH_FONT_SIZE_SHIFT
+        uint8_t  font_id;
+        uint8_t  subpixel_phase; // Horizontal offset of phase / NVG_GLYPH_SUBPIXEL_PHASES pixels. Always 0 by default
     };
     uint64_t data;
 } NVGatlasRectHeader;
@@ -729,16 +889,49 @@ typedef struct NVGatlasRect
     int8_t bearing_x;
     int8_t bearing_y;
 
+    uint8_t  atlas_idx;       // Index into ctx->glyph_atlases
+    uint32_t last_used_frame; // Only kept up to date in ctx->rects
+
     sg_view img_view;
 } NVGatlasRect;
 
 typedef struct NVGatlas
 {
-    sg_view img_view;
-    bool    dirty;
-    bool    full;
+    sg_image       img;
+    sg_view        img_view;
+    sg_view        att_view; // Pages are render targets. Dirty rows are drawn in from staging images
+    NVGdirtyRects  dirty;
+    bool           full;
+    bool           needs_clear; // Set on new & evicted pages. The next upload pass clears the page first
+    uint32_t       last_used_frame;
+    unsigned char* img_data; // CPU copy of the page, made once it's full. Only kept with NVG_GLYPH_CACHE_PIXELS
 } NVGatlas;
 
+// A band of NVG_ATLAS_UPLOAD_ROWS rows waiting in a staging image to be drawn into an atlas page
+typedef struct NVGatlasCopy
+{
+    int atlas_idx;
+    int staging_idx;
+    int y0;
+} NVGatlasCopy;
+
+typedef struct NVGlayoutCacheEntry
+{
+    uint64_t              hash;
+    const char*           text; // Copy owned by the cache
+    uint32_t              text_len;
+    uint32_t              generation;
+    uint32_t              glyph_epoch;
+    uint32_t              glyph_land_epoch;
+    bool                  has_pending; // Holds glyphs queued for the background rasterizer
+    int                   font_id;
+    int                   backing_scale;
+    float                 font_size;
+    float                 break_width;
+    float                 line_height;
+    struct NVGtextLayout* layout; // NULL marks an empty slot
+} NVGlayoutCacheEntry;
+
 typedef struct NVGcontext
 {
     LinkedArena* arena;
@@ -756,6 +949,21 @@ typedef struct NVGcontext
     float        fringeWidth;
     int          backingScaleFactor;
 
+    // cos, sin pairs around the unit circle. See nvg__circleSegments()
+    float unit_circle[NVG_MAX_CIRCLE_SEGMENTS * 2];
+
+    // Set when the path is a single rect, rounded rect or circle under an axis aligned transform, so nvgFill() &
+    // nvgStroke() can draw it as an SGNVGshape. Only valid while ncommands still matches
+    struct
+    {
+        int   ncommands;
+        float rect[4];
+        float radii[4];
+    } shape_hint;
+
+    // Hashes of the commands of paths NVG_TRIANGULATE_CONCAVE failed to ear clip. 0 marks an empty slot
+    uint64_t triangulate_failures[NVG_TRIANGULATE_FAILURES];
+
     // Old
     // struct FONScontext* fs;
     // int fontImages[NVG_MAX_FONTIMAGES];
@@ -782,8 +990,17 @@ typedef struct NVGcontext
     // This leaves 0 and <0 as invalid ids
     NVGfontSlot fonts[NVG_MAX_FONT_SLOTS];
 
+#ifndef NVG_MAX_GLYPH_ATLASES
+#define NVG_MAX_GLYPH_ATLASES 16
+#endif
+    // Once NVG_MAX_GLYPH_ATLASES pages are in use, the least recently used page is evicted and repacked.
+    // WARNING: layouts kept alive across frames may reference glyphs on evicted pages
     NVGatlas*     glyph_atlases;
     NVGatlasRect* rects;
+    // Open addressing hash index into 'rects', keyed by NVGatlasRectHeader.
+    // Slots store rect index + 1. 0 marks an empty slot. Capacity is always a power of 2
+    uint32_t* rects_index;
+    uint32_t  rects_index_cap;
 
     struct
     {
@@ -793,17 +1010,66 @@ typedef struct NVGcontext
         unsigned char* img_data;
     } current_atlas;
 
+#ifndef NVG_ATLAS_UPLOAD_ROWS
+#define NVG_ATLAS_UPLOAD_ROWS 32
+#endif
+    // sokol_gfx can only replace whole images. Dirty atlas rows are uploaded in bands to small staging images, which
+    // are drawn into the atlas pages in nvgEndFrame()
+    struct
+    {
+        sg_image*     staging; // xarr. Each can only be updated once per frame
+        sg_view*      staging_views;
+        int           num_staging_used; // Reset by nvgBeginFrame(), which frees the ones last frame didn't use
+        NVGatlasCopy* copies;           // xarr. Drawn & cleared in nvgEndFrame()
+        sg_shader     shd;
+        sg_pipeline   pip;
+    } atlas_upload;
+
+    // Incremented whenever cached glyphs are dropped. Layouts made before then may reference stale atlas regions
+    uint32_t glyph_epoch;
+    // Incremented whenever glyphs from the background rasterizer land. Only layouts holding NVG_GLYPH_PENDING glyphs
+    // need rebuilding, the rest are still valid
+    uint32_t glyph_land_epoch;
+
+    // Subpixel phase of the glyph being looked up. Set by layouts with NVG_SUBPIXEL_GLYPHS
+    uint8_t glyph_phase;
+
+    // Background glyph rasterizer. Only created with NVG_ASYNC_GLYPHS
+    struct NVGglyphWorker* glyph_worker;
+
+    // Glyphs rastered while making a layout are packed together once the layout is done
+    struct
+    {
+        bool                   active;
+        struct NVGglyphBitmap* glyphs;  // xarr
+        unsigned char*         staging; // xarr
+        stbrp_rect*            rects;   // xarr
+    } glyph_batch;
+
+#ifndef NVG_LAYOUT_CACHE_GENERATION_FRAMES
+#define NVG_LAYOUT_CACHE_GENERATION_FRAMES 120
+#endif
+    // Cross frame layout cache, see nvgMakeLayoutCached()
+    // Layouts live in one of two arenas, one per generation. Every NVG_LAYOUT_CACHE_GENERATION_FRAMES frames the
+    // oldest generation is dropped. Layouts used during the previous generation get copied forward into the current
+    struct
+    {
+        LinkedArena*         arenas[2];
+        NVGlayoutCacheEntry* entries; // Open addressing hash table. Capacity is always a power of 2
+        uint32_t             cap;
+        uint32_t             num;
+        uint32_t             generation;
+        uint32_t             generation_start_frame;
+    } layout_cache;
+
     // Text pipeline
     sg_pipeline text_pip;
     sg_buffer   text_sbo;
     sg_view     text_sbv;
     sg_sampler  text_smp;
 
-#ifndef NVG_MAX_GLYPHS
-#define NVG_MAX_GLYPHS 1024
-#endif
-    size_t        text_buffer_len;
-    text_buffer_t text_buffer[NVG_MAX_GLYPHS];
+    text_buffer_t* text_buffer;  // xarr. Glyphs drawn this frame, uploaded to text_sbo in nvgEndFrame()
+    size_t         text_sbo_cap; // Number of glyphs text_sbo can hold. Grows on demand
 
     struct
     {
@@ -813,7 +1079,36 @@ typedef struct NVGcontext
         int textTriCount;
         // Track how much data is uploaded to GPU
         size_t uploaded_bytes;
+
+        // Glyph cache
+        int glyph_cache_hits;
+        int glyph_cache_misses;
+        int glyph_atlas_evictions;
+        int glyph_atlas_pages; // Number of atlas pages in use
+        // Cached glyphs rastered at a non-zero subpixel phase. Not reset each frame. See NVG_SUBPIXEL_GLYPHS
+        int glyph_subpixel_variants;
+        int glyph_async_queued;
+        int glyph_async_landed;
+
+        // Layout cache
+        int layout_cache_hits;
+        int layout_cache_misses;
+
+        // Text draws folded into the previous text draw by snvg_consume_commands()
+        int text_draws_merged;
+        // nvg calls drawn together with the previous call by sgnvg__renderNVGCalls()
+        int nvg_calls_merged;
+        // Fills & strokes drawn as SGNVGshape instead of tessellated
+        int shapes_drawn;
+        // Concave fills ear clipped instead of stenciled. See NVG_TRIANGULATE_CONCAVE
+        int fills_triangulated;
+        // Pipelines built this frame. Blends used after startup should be warmed with nvgWarmPipelines()
+        int pipelines_created;
+        // vertBuf & indexBuf reallocations. See NVG_STREAM_SHRINK_FRAMES
+        int stream_buffer_resizes;
     } frame_stats;
+    // Incremented every nvgBeginFrame(). Used for LRU stamps
+    uint32_t frame_id;
 
     // SGNVGcontext....
 
@@ -840,10 +1135,25 @@ typedef struct NVGcontext
     int             cverts;
     int             nverts;
     int             cverts_gpu;
+    int             nverts_gpu;     // Appended to vertBuf so far this frame
+    int             idle_verts_gpu; // Consecutive frames using under a quarter of vertBuf
     uint32_t*       indexes;
     int             cindexes;
     int             nindexes;
     int             cindexes_gpu;
+    int             nindexes_gpu;
+    int             idle_indexes_gpu;
+
+    SGNVGfragUniforms* frag_uniforms; // xarr. Uploaded to frag_sbo in nvgEndFrame()
+    sg_buffer          frag_sbo;
+    sg_view            frag_sbv;
+    size_t             frag_sbo_cap; // Number of uniforms frag_sbo can hold. Grows on demand
+
+    sg_shader   shape_shader;
+    SGNVGshape* shapes; // xarr. Uploaded to shape_sbo in nvgEndFrame()
+    sg_buffer   shape_sbo;
+    sg_view     shape_sbv;
+    size_t      shape_sbo_cap; // Number of shapes shape_sbo can hold. Grows on demand
 
     sg_sampler sampler_linear;
     sg_sampler sampler_nearest;
@@ -859,9 +1169,25 @@ typedef struct NVGcontext
     SGNVGcommand*    current_command;  // linked list current position
     SGNVGcommand*    first_command;    // linked list start
 
+    // Set between nvgBeginDisplayList() & nvgEndDisplayList(). Calls are collected in 'draws' instead of the frame's
+    // commands, and their vertices & indexes are cut from the frame buffers when the list is made
+    struct
+    {
+        bool             active;
+        SGNVGcommandNVG  draws;
+        SGNVGcall*       prev_call;
+        SGNVGcommandNVG* prev_nvg_draw;
+        int              vert_start;
+        int              index_start;
+        int              uniform_start;
+    } list_recording;
+
     // state
     int            pipelineCacheIndex;
     sg_blend_state blend;
+    sg_buffer      drawVertBuf; // Bound for nvg calls. Either vertBuf or a display list's buffers
+    sg_buffer      drawIndexBuf;
+    sg_view        drawFragView;
 
     int     dummyTex;
     sg_view dummyTexView;
@@ -876,10 +1202,10 @@ typedef struct NVGglyphPosition2
 typedef struct NVGtextLayoutRow
 {
     // Indexes into glyphs array in struct NVGtextLayout below
-    short begin_idx, end_idx;
-    short ymin, ymax;
-    short xmin, xmax;
-    int   cursor_y_px;
+    int begin_idx, end_idx;
+    int ymin, ymax;
+    int xmin, xmax;
+    int cursor_y_px;
 } NVGtextLayoutRow;
 
 // Glyphs are shaped and aligned from left > right along the baseline of row one
@@ -894,7 +1220,11 @@ typedef struct NVGtextLayout
     // own pixel space
     short ascender, descender;
     short line_height;
-    short xmax; // The right edge of the longest (in pixels) row
+    int   xmax; // The right edge of the longest (in pixels) row
+
+    // Draw size / raster size of the glyphs. Their metrics are in raster pixels, positions are in layout pixels.
+    // Always 1 except with NVG_FONT_FREETYPE_SDF
+    float glyph_scale;
 
     int total_height;
     int total_height_tight;
@@ -916,6 +1246,44 @@ static NVGglyphPosition2* nvgLayoutGetGlyphs(const NVGtextLayout* l)
 }
 static void nvgLayoutSetGlyphs(NVGtextLayout* l, NVGglyphPosition2* g) { l->offset_glyphs = ((char*)g - (char*)l); }
 
+// The text between two '\n' in an NVGeditableLayout. Each paragraph is laid out on its own
+typedef struct NVGeditableParagraph
+{
+    int  text_begin, text_end; // Byte offsets into the text. Excludes the '\n'
+    int  num_glyphs;
+    int  num_rows;
+    int  glyph_base, row_base; // Where the glyphs & rows start. Stale from NVGeditableLayout.stale_para on
+    bool has_pending;          // Holds glyphs queued for the background rasterizer
+} NVGeditableParagraph;
+
+// Layout for text edited a little at a time, eg. text fields & log views. An edit only reshapes the paragraphs it
+// touches, then splices their glyphs & rows into the layout. The rows that follow are moved once, when the layout is
+// next fetched with nvgGetEditableLayout()
+typedef struct NVGeditableLayout
+{
+    char*                 text;       // xarr. Not NUL terminated
+    NVGeditableParagraph* paragraphs; // xarr
+    // Single allocation of the layout, followed by its glyphs & rows. Brought up to date by nvgGetEditableLayout()
+    NVGtextLayout* layout;
+    int            stale_para; // First paragraph whose indexes, positions & text offsets are out of date
+    bool           xmax_stale; // The widest row was replaced by narrower ones
+
+    // Paragraphs laid out by the current edit, waiting to be spliced in
+    NVGeditableParagraph* scratch_paragraphs; // xarr
+    NVGglyphPosition2*    scratch_glyphs;     // xarr
+    NVGtextLayoutRow*     scratch_rows;       // xarr
+
+    int      font_id;
+    int      backing_scale;
+    float    font_size;
+    float    break_row_width;
+    float    line_height;
+    int64_t  row_height; // 26.6 distance between rows, the same as the CursorY steps in a full layout
+    int      ascender, descender; // 26.6
+    uint32_t glyph_epoch;
+    uint32_t glyph_land_epoch;
+} NVGeditableLayout;
+
 NVGcontext* nvgCreateContext(int flags);
 void        nvgDestroyContext(NVGcontext* ctx);
 
@@ -952,6 +1320,10 @@ void nvgSetGlobalCompositeBlendFunc(NVGcontext* ctx, int sfactor, int dfactor);
 // should be one of NVGblendFactor.
 void nvgSetGlobalCompositeBlendFuncSeparate(NVGcontext* ctx, int srcRGB, int dstRGB, int srcAlpha, int dstAlpha);
 
+// Builds the pipelines of each composite operation up front, so their first use mid-frame doesn't hitch. The ops
+// should be NVGcompositeOperation values, no more than NANOVG_SG_PIPELINE_CACHE_SIZE. Call after nvgCreateContext()
+void nvgWarmPipelines(NVGcontext* ctx, const int* ops, int nops);
+
 //
 // Colour utils
 //
@@ -1308,6 +1680,24 @@ void nvgFill(NVGcontext* ctx);
 // Fills the current path with current stroke style.
 void nvgStroke(NVGcontext* ctx, float stroke_width);
 
+// Tessellates the current path once with the current transform, fill/stroke settings & antialiasing, without drawing.
+// Redraw it any number of frames with nvgDrawPathHandle(), using the paint, scissor & composite operation current at
+// that time. The fringe & stroke width are scaled along with the geometry, so keep redraw transforms close to the
+// recorded scale. Returns NULL for an empty path. Free with nvgDestroyPathHandle()
+NVGpathHandle* nvgRecordFill(NVGcontext* ctx);
+NVGpathHandle* nvgRecordStroke(NVGcontext* ctx, float stroke_width);
+void           nvgDrawPathHandle(NVGcontext* ctx, const NVGpathHandle* handle);
+void           nvgDestroyPathHandle(NVGcontext* ctx, NVGpathHandle* handle);
+
+// Records the fills & strokes issued until nvgEndDisplayList() into immutable GPU buffers, instead of drawing them.
+// Paints, scissors & transforms are baked in, so replays land in the same place in the pass.
+// Call within a frame, and don't issue other commands or text while recording.
+// Replay any number of frames with snvg_command_draw_list(). Free with nvgDestroyDisplayList().
+// Returns NULL if out of memory, in which case nothing recorded is kept
+void            nvgBeginDisplayList(NVGcontext* ctx);
+NVGdisplayList* nvgEndDisplayList(NVGcontext* ctx, const char* label);
+void            nvgDestroyDisplayList(NVGcontext* ctx, NVGdisplayList* list);
+
 //
 // Text
 //
@@ -1451,8 +1841,58 @@ const NVGtextLayout*
 nvgMakeLayout(NVGcontext* ctx, const char* text_start, const char* text_end, float font_size, float breakRowWidth);
 // Lower quality, but still looks fairly good.
 // Suitable for realtime text layout, like short updating labels (eg. -3.14 dB)
+// Every character must have a glyph in the current font
 const NVGtextLayout*
 nvgMakeLayoutFast(NVGcontext* ctx, const char* start, const char* end, float font_size, float breakRowWidth);
+// Picks nvgMakeLayoutFast() when the text is plain Latin/ASCII & the current font has all its glyphs, otherwise falls
+// back to nvgMakeLayout()
+const NVGtextLayout*
+nvgMakeLayoutAuto(NVGcontext* ctx, const char* start, const char* end, float font_size, float breakRowWidth);
+// Same as nvgMakeLayoutAuto(), but glyphs are only measured and never rastered to an atlas.
+// Use for measuring text, eg. when fitting text to columns. The returned layout can't be drawn
+const NVGtextLayout*
+nvgMeasureLayout(NVGcontext* ctx, const char* start, const char* end, float font_size, float breakRowWidth);
+
+// Rasters the glyphs for each codepoint in the UTF-8 string 'codepoints' using the given font & size, filling the glyph
+// cache ahead of time. Useful at startup. With NVG_ASYNC_GLYPHS, glyphs are queued for the background rasterizer.
+// Glyphs are rastered at size * backingScaleFactor, so pass the scale later given to nvgBeginFrame()
+void nvgPrewarmGlyphs(NVGcontext* ctx, int font, float size, int backingScaleFactor, const char* codepoints);
+
+// Writes the glyph atlas pages & cached glyph metrics to a file, so another context can skip rastering them.
+// The file is keyed by the loaded fonts & atlas format. Returns 0 on failure
+int nvgSaveGlyphCache(NVGcontext* ctx, const char* path);
+// Memory maps a file written by nvgSaveGlyphCache() & uploads its atlas pages. Call after creating all fonts, in the
+// same order they were created in when saving, and before drawing any text.
+// Returns 0 if the file is missing, was made with different fonts or atlas settings, or glyphs are already cached
+int nvgLoadGlyphCache(NVGcontext* ctx, const char* path);
+
+// Returns a layout from the cross frame layout cache, making one if necessary.
+// Keyed by the text, current font, font size, line height, backing scale & breakRowWidth
+// The layout is owned by the cache. Don't call nvgReleaseLayout() on it, and don't keep it past the current frame
+const NVGtextLayout*
+nvgMakeLayoutCached(NVGcontext* ctx, const char* start, const char* end, float font_size, float breakRowWidth);
+
+// Makes a layout that can be edited in place with nvgEditableLayoutReplace(). Uses the current font & line height.
+// Destroy with nvgDestroyEditableLayout()
+NVGeditableLayout* nvgCreateEditableLayout(
+    NVGcontext* ctx,
+    const char* start,
+    const char* end,
+    float       font_size,
+    float       breakRowWidth);
+void nvgDestroyEditableLayout(NVGcontext* ctx, NVGeditableLayout* el);
+// Replaces the bytes [start, end) of the text with 'text'. Pass start == end to insert, or an empty 'text' to delete.
+// Only the paragraphs containing the edit are reshaped
+void nvgEditableLayoutReplace(
+    NVGcontext*        ctx,
+    NVGeditableLayout* el,
+    int                start,
+    int                end,
+    const char*        text,
+    const char*        text_end);
+// Returns the layout for drawing. It stays owned by 'el', and is only valid until the next edit.
+// Glyphs are looked up again if the glyph atlases have changed since the last edit
+const NVGtextLayout* nvgGetEditableLayout(NVGcontext* ctx, NVGeditableLayout* el);
 
 void        nvgDrawLayout(NVGcontext* ctx, const NVGtextLayout* layout, int x, int y);
 static void nvgReleaseLayout(NVGcontext* ctx, const NVGtextLayout* layout) { linked_arena_release(ctx->arena, layout); }
@@ -1478,6 +1918,8 @@ void snvg_command_begin_pass(
     const char* label);
 void snvg_command_end_pass(NVGcontext* ctx, const char* label);
 void snvg_command_draw_nvg(NVGcontext* ctx, const char* label);
+// Replays a display list made with nvgEndDisplayList(). Keep the list alive until the frame is drawn
+void snvg_command_draw_list(NVGcontext* ctx, const NVGdisplayList* list, const char* label);
 // 'radius_px' can be animated each frame. For best performance, finish your animations with radius at a power of 2,
 // and a minimum of 8px
 void snvg_command_fx(